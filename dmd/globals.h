@@ -306,6 +306,15 @@ struct Param
 
     LinkonceTemplates linkonceTemplates; // -linkonce-templates
 
+    bool ctfeBytecode; // -ctfe-bytecode
+    bool ctfeMemoize;  // -ctfe-memoize
+
+    unsigned semanticJobs; // -semantic-jobs
+
+    bool templateIndexStats; // -vtemplates=index
+    bool speculativeRollback; // -speculative-rollback
+    bool lazyImportSemantic; // -lazy-import-semantic
+
     // Windows-specific:
     bool dllexport;      // dllexport ~all defined symbols?
     DLLImport dllimport; // dllimport data symbols not defined in any root module?
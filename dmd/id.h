@@ -99,5 +99,6 @@ struct Id
     static Identifier *udaNoSanitize;
     static Identifier *udaNoSplitStack;
     static Identifier *io;
+    static Identifier *_d_arrayappendcTX;
 #endif
 };
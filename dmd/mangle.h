@@ -34,4 +34,7 @@ namespace dmd
     void mangleToBuffer(Expression *s, OutBuffer& buf);
     void mangleToBuffer(Dsymbol *s, OutBuffer& buf);
     void mangleToBuffer(TemplateInstance *s, OutBuffer& buf);
+#if IN_LLVM
+    const char *mangleCached(Dsymbol *s);
+#endif
 }
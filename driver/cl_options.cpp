@@ -100,7 +100,7 @@ static cl::opt<bool, true>
 // any value.
 using DummyDataType = bool;
 
-// `-vtemplates[=list-instances]` parser.
+// `-vtemplates[=list-instances|index]` parser.
 struct VTemplatesParser : public cl::parser<DummyDataType> {
   explicit VTemplatesParser(cl::Option &O) : cl::parser<DummyDataType>(O) {}
 
@@ -117,6 +117,11 @@ struct VTemplatesParser : public cl::parser<DummyDataType> {
       return false;
     }
 
+    if (Arg == "index") {
+      global.params.templateIndexStats = true;
+      return false;
+    }
+
     return O.error("unsupported value '" + Arg + "'");
   }
 };
@@ -125,7 +130,9 @@ static cl::opt<DummyDataType, false, VTemplatesParser> vtemplates(
     "vtemplates", cl::ZeroOrMore, cl::ValueOptional,
     cl::desc("List statistics on template instantiations\n"
              "Use -vtemplates=list-instances to additionally show all "
-             "instantiation contexts for each template"));
+             "instantiation contexts for each template\n"
+             "Use -vtemplates=index to additionally show lookups, hits and "
+             "hash collisions in the table of instances of each template"));
 
 static cl::opt<bool, true> verbose_cg("v-cg", cl::desc("Verbose codegen"),
                                       cl::ZeroOrMore,
@@ -526,6 +533,34 @@ static cl::opt<LinkonceTemplates, true> linkonceTemplates(
                    "linkonce-templates-aggressive",
                    "Experimental, more aggressive variant")));
 
+static cl::opt<bool, true> ctfeBytecode(
+    "ctfe-bytecode", cl::ZeroOrMore, cl::location(global.params.ctfeBytecode),
+    cl::desc("Evaluate supported functions in CTFE by compiling them to "
+             "bytecode, falling back to the AST interpreter (experimental)"));
+
+static cl::opt<bool, true> ctfeMemoize(
+    "ctfe-memoize", cl::ZeroOrMore, cl::location(global.params.ctfeMemoize),
+    cl::desc("Cache the results of CTFE calls of strongly pure functions and "
+             "reuse them for calls with equal arguments"));
+
+static cl::opt<bool, true> speculativeRollback(
+    "speculative-rollback", cl::ZeroOrMore,
+    cl::location(global.params.speculativeRollback),
+    cl::desc("Skip further semantic analysis of the template instances created "
+             "by failing __traits(compiles) and is() evaluations"));
+
+static cl::opt<bool, true> lazyImportSemantic(
+    "lazy-import-semantic", cl::ZeroOrMore,
+    cl::location(global.params.lazyImportSemantic),
+    cl::desc("Only analyze the declarations of imported modules (semantic2) "
+             "when they are referenced or needed for inlining"));
+
+static cl::opt<unsigned, true> semanticJobs(
+    "semantic-jobs", cl::ZeroOrMore, cl::value_desc("n"),
+    cl::location(global.params.semanticJobs),
+    cl::desc("Analyze the function bodies of and generate code for the root "
+             "modules in <n> worker processes (experimental, Posix only)"));
+
 cl::opt<bool> disableLinkerStripDead(
     "disable-linker-strip-dead", cl::ZeroOrMore,
     cl::desc("Do not try to remove unused symbols during linking"),
@@ -584,6 +619,17 @@ cl::opt<bool>
     fSplitStack("fsplit-stack", cl::ZeroOrMore,
                 cl::desc("Use segmented stack (see Clang documentation)"));
 
+cl::opt<bool> fPreciseDataScan(
+    "fprecise-data-scan", cl::ZeroOrMore,
+    cl::desc("Report pointer-free global and thread-local variables to the "
+             "GC, which then excludes them from scanning the data and TLS "
+             "segments (ELF only)"));
+
+cl::opt<bool> gcWriteBarriers(
+    "gc-write-barriers", cl::ZeroOrMore,
+    cl::desc("Emit card-marking write barriers for pointer stores into the "
+             "GC heap, required by the generational GC mode"));
+
 cl::opt<bool, true>
     allinst("allinst", cl::ZeroOrMore, cl::location(global.params.allInst),
             cl::desc("Generate code for all template instantiations"));
@@ -655,7 +701,10 @@ cl::opt<CoverageIncrement> coverageIncrement(
                clEnumValN(CoverageIncrement::nonatomic, "non-atomic",
                           "Non-atomic increment (not thread safe)"),
                clEnumValN(CoverageIncrement::boolean, "boolean",
-                          "Don't read, just set counter to 1")));
+                          "Don't read, just set counter to 1"),
+               clEnumValN(CoverageIncrement::sharded, "sharded",
+                          "Non-atomic increment of thread-local counters, "
+                          "merged when threads terminate")));
 
 // Compilation time tracing options
 cl::opt<bool> fTimeTrace(
@@ -104,6 +104,8 @@ extern cl::opt<bool> fNoExceptions;
 extern cl::opt<bool> fNoModuleInfo;
 extern cl::opt<bool> fNoRTTI;
 extern cl::opt<bool> fSplitStack;
+extern cl::opt<bool> gcWriteBarriers;
+extern cl::opt<bool> fPreciseDataScan;
 
 // Arguments to -d-debug
 extern std::vector<std::string> debugArgs;
@@ -117,7 +119,8 @@ enum class CoverageIncrement
     _default,
     atomic,
     nonatomic,
-    boolean
+    boolean,
+    sharded
 };
 extern cl::opt<CoverageIncrement> coverageIncrement;
 
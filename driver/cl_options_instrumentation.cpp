@@ -84,6 +84,18 @@ static cl::opt<bool> dmdFunctionTrace(
     "fdmd-trace-functions", cl::ZeroOrMore,
     cl::desc("DMD-style runtime performance profiling of generated code"));
 
+cl::opt<bool> dmdFunctionTraceBuffered(
+    "fdmd-trace-buffered", cl::ZeroOrMore,
+    cl::desc("DMD-style profiling recording timestamped function entries and "
+             "exits into per-thread buffers, post-processed by druntime "
+             "(implies -fdmd-trace-functions)"));
+
+cl::opt<unsigned> dmdFunctionTraceThreshold(
+    "fdmd-trace-instruction-threshold", cl::ZeroOrMore, cl::init(0),
+    cl::value_desc("value"),
+    cl::desc("Only trace functions with at least this many (unoptimized) IR "
+             "instructions for DMD-style profiling"));
+
 cl::opt<bool> fXRayInstrument(
     "fxray-instrument", cl::ZeroOrMore,
     cl::desc("Generate XRay instrumentation sleds on function entry and exit"));
@@ -136,7 +148,7 @@ void initializeInstrumentationOptionsFromCmdline(const llvm::Triple &triple) {
     global.params.datafileInstrProf = fromPathString(SamplePGOInstrUseFile).ptr;
   }
 
-  if (dmdFunctionTrace)
+  if (dmdFunctionTrace || dmdFunctionTraceBuffered)
     global.params.trace = true;
 
   // fcf-protection is only valid for X86
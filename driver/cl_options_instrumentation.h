@@ -26,6 +26,9 @@ namespace cl = llvm::cl;
 
 extern cl::opt<bool> instrumentFunctions;
 
+extern cl::opt<bool> dmdFunctionTraceBuffered;
+extern cl::opt<unsigned> dmdFunctionTraceThreshold;
+
 extern cl::opt<bool> fXRayInstrument;
 llvm::StringRef getXRayInstructionThresholdString();
 
@@ -422,6 +422,14 @@ void parseCommandLine(Strings &sourceFiles) {
   if (includeImports)
     global.params.oneobj = true;
 
+#if LDC_LLVM_SUPPORTED_TARGET_SPIRV || LDC_LLVM_SUPPORTED_TARGET_NVPTX
+  // The DCompute kernels of all modules are written to shared files.
+  if (global.params.semanticJobs > 1 && !opts::dcomputeTargets.empty()) {
+    warning(Loc(), "`-semantic-jobs` is ignored with `-mdcompute-targets`");
+    global.params.semanticJobs = 0;
+  }
+#endif
+
   if (saveOptimizationRecord.getNumOccurrences() > 0) {
     global.params.outputSourceLocations = true;
   }
@@ -971,6 +979,10 @@ void registerPredefinedVersions() {
     VersionCondition::addPredefinedGlobalIdent("D_Ddoc");
   }
 
+  if (opts::gcWriteBarriers) {
+    VersionCondition::addPredefinedGlobalIdent("LDC_GCWriteBarriers");
+  }
+
   if (global.params.cov) {
     VersionCondition::addPredefinedGlobalIdent("D_Coverage");
   }
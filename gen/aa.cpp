@@ -13,12 +13,14 @@
 #include "dmd/declaration.h"
 #include "dmd/module.h"
 #include "dmd/mtype.h"
+#include "driver/cl_helpers.h"
 #include "gen/arrays.h"
 #include "gen/dvalue.h"
 #include "gen/irstate.h"
 #include "gen/llvm.h"
 #include "gen/llvmhelpers.h"
 #include "gen/logger.h"
+#include "gen/optimizer.h"
 #include "gen/runtime.h"
 #include "gen/tollvm.h"
 #include "ir/irfunction.h"
@@ -35,6 +37,62 @@ static LLConstant *to_keyti(const Loc &loc, DValue *aa, LLType *targetType) {
   return DtoBitCast(ti, targetType);
 }
 
+static llvm::cl::opt<llvm::cl::boolOrDefault, false,
+                     opts::FlagParser<llvm::cl::boolOrDefault>>
+    directAAKeyOps(
+        "direct-aa-key-ops", llvm::cl::ZeroOrMore,
+        llvm::cl::desc("(*) Hash and compare integral and string AA keys "
+                       "with direct runtime functions instead of virtual "
+                       "TypeInfo calls (default when optimizing)"));
+
+// Returns the suffix of the druntime `_aaKeyHash_*`/`_aaKeyEquals_*` functions
+// matching the key type of the AA, or null if the key has to be hashed and
+// compared through its TypeInfo. The suffix is the mangled unsigned base type.
+static const char *getDirectKeyOpsSuffix(DValue *aa) {
+  if (!getFlagOrDefault(directAAKeyOps, isOptimizationEnabled()))
+    return nullptr;
+
+  TypeAArray *aatype = static_cast<TypeAArray *>(aa->type->toBasetype());
+  Type *keyType = aatype->index->toBasetype();
+  bool isArray = false;
+  if (keyType->ty == TY::Tarray) {
+    // arrays of enums are hashed element-wise through the enum TypeInfo,
+    // so only accept the element types with a builtin array TypeInfo
+    keyType = keyType->nextOf();
+    isArray = true;
+  }
+  if (!keyType->isTypeBasic() || !keyType->isintegral())
+    return nullptr;
+
+  static const char *const scalarSuffixes[] = {"h", "t", "k", "m"};
+  static const char *const arraySuffixes[] = {"Ah", "At", "Ak", "Am"};
+  const auto &suffixes = isArray ? arraySuffixes : scalarSuffixes;
+  switch (keyType->size()) {
+  case 1:
+    return suffixes[0];
+  case 2:
+    return suffixes[1];
+  case 4:
+    return suffixes[2];
+  case 8:
+    return suffixes[3];
+  default:
+    return nullptr;
+  }
+}
+
+// Appends the direct key hash and equality functions to the arguments of one
+// of the `_aa*D` runtime hooks.
+static void appendDirectKeyOps(const Loc &loc, const char *suffix,
+                               LLFunctionType *funcTy,
+                               llvm::SmallVectorImpl<LLValue *> &args) {
+  for (const char *prefix : {"_aaKeyHash_", "_aaKeyEquals_"}) {
+    const std::string name = (llvm::Twine(prefix) + suffix).str();
+    LLValue *fn = getRuntimeFunction(loc, gIR->module, name.c_str());
+    args.push_back(DtoBitCast(fn, funcTy->getParamType(args.size())));
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 DLValue *DtoAAIndex(const Loc &loc, Type *type, DValue *aa, DValue *key,
@@ -45,10 +103,13 @@ DLValue *DtoAAIndex(const Loc &loc, Type *type, DValue *aa, DValue *key,
   // pkey)
   // or
   // extern(C) void* _aaInX(AA aa*, TypeInfo keyti, void* pkey)
+  // or their `_aaGetYD`/`_aaInXD` variants taking direct key functions
 
   // first get the runtime function
-  llvm::Function *func =
-      getRuntimeFunction(loc, gIR->module, lvalue ? "_aaGetY" : "_aaInX");
+  const char *keyOps = getDirectKeyOpsSuffix(aa);
+  const char *funcName = lvalue ? (keyOps ? "_aaGetYD" : "_aaGetY")
+                                : (keyOps ? "_aaInXD" : "_aaInX");
+  llvm::Function *func = getRuntimeFunction(loc, gIR->module, funcName);
   LLFunctionType *funcTy = func->getFunctionType();
 
   // aa param
@@ -60,18 +121,20 @@ DLValue *DtoAAIndex(const Loc &loc, Type *type, DValue *aa, DValue *key,
   pkey = DtoBitCast(pkey, funcTy->getParamType(lvalue ? 3 : 2));
 
   // call runtime
-  LLValue *ret;
+  llvm::SmallVector<LLValue *, 6> args;
   if (lvalue) {
     auto t = mutableOf(unSharedOf(aa->type));
     LLValue *rawAATI = DtoTypeInfoOf(loc, t, /*base=*/false);
     LLValue *castedAATI = DtoBitCast(rawAATI, funcTy->getParamType(1));
     LLValue *valsize = DtoConstSize_t(getTypeAllocSize(DtoType(type)));
-    ret = gIR->CreateCallOrInvoke(func, aaval, castedAATI, valsize, pkey,
-                                  "aa.index");
+    args = {aaval, castedAATI, valsize, pkey};
   } else {
     LLValue *keyti = to_keyti(loc, aa, funcTy->getParamType(1));
-    ret = gIR->CreateCallOrInvoke(func, aaval, keyti, pkey, "aa.index");
+    args = {aaval, keyti, pkey};
   }
+  if (keyOps)
+    appendDirectKeyOps(loc, keyOps, funcTy, args);
+  LLValue *ret = gIR->CreateCallOrInvoke(func, args, "aa.index");
 
   // cast return value
   LLType *targettype = DtoPtrToType(type);
@@ -109,9 +172,12 @@ DValue *DtoAAIn(const Loc &loc, Type *type, DValue *aa, DValue *key) {
   // D2:
   // call:
   // extern(C) void* _aaInX(AA aa*, TypeInfo keyti, void* pkey)
+  // or its `_aaInXD` variant taking direct key functions
 
   // first get the runtime function
-  llvm::Function *func = getRuntimeFunction(loc, gIR->module, "_aaInX");
+  const char *keyOps = getDirectKeyOpsSuffix(aa);
+  llvm::Function *func =
+      getRuntimeFunction(loc, gIR->module, keyOps ? "_aaInXD" : "_aaInX");
   LLFunctionType *funcTy = func->getFunctionType();
 
   IF_LOG Logger::cout() << "_aaIn = " << *func << '\n';
@@ -132,7 +198,10 @@ DValue *DtoAAIn(const Loc &loc, Type *type, DValue *aa, DValue *key) {
   pkey = DtoBitCast(pkey, getVoidPtrType());
 
   // call runtime
-  LLValue *ret = gIR->CreateCallOrInvoke(func, aaval, keyti, pkey, "aa.in");
+  llvm::SmallVector<LLValue *, 5> args = {aaval, keyti, pkey};
+  if (keyOps)
+    appendDirectKeyOps(loc, keyOps, funcTy, args);
+  LLValue *ret = gIR->CreateCallOrInvoke(func, args, "aa.in");
 
   // cast return value
   LLType *targettype = DtoType(type);
@@ -153,9 +222,12 @@ DValue *DtoAARemove(const Loc &loc, DValue *aa, DValue *key) {
   // D2:
   // call:
   // extern(C) bool _aaDelX(AA aa, TypeInfo keyti, void* pkey)
+  // or its `_aaDelXD` variant taking direct key functions
 
   // first get the runtime function
-  llvm::Function *func = getRuntimeFunction(loc, gIR->module, "_aaDelX");
+  const char *keyOps = getDirectKeyOpsSuffix(aa);
+  llvm::Function *func =
+      getRuntimeFunction(loc, gIR->module, keyOps ? "_aaDelXD" : "_aaDelX");
   LLFunctionType *funcTy = func->getFunctionType();
 
   IF_LOG Logger::cout() << "_aaDel = " << *func << '\n';
@@ -176,7 +248,10 @@ DValue *DtoAARemove(const Loc &loc, DValue *aa, DValue *key) {
   pkey = DtoBitCast(pkey, funcTy->getParamType(2));
 
   // call runtime
-  LLValue *res = gIR->CreateCallOrInvoke(func, aaval, keyti, pkey);
+  llvm::SmallVector<LLValue *, 5> args = {aaval, keyti, pkey};
+  if (keyOps)
+    appendDirectKeyOps(loc, keyOps, funcTy, args);
+  LLValue *res = gIR->CreateCallOrInvoke(func, args);
 
   return new DImValue(Type::tbool, res);
 }
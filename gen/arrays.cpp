@@ -14,21 +14,25 @@
 #include "dmd/dsymbol.h"
 #include "dmd/errors.h"
 #include "dmd/expression.h"
+#include "dmd/id.h"
 #include "dmd/init.h"
 #include "dmd/module.h"
 #include "dmd/mtype.h"
+#include "driver/cl_helpers.h"
 #include "gen/dvalue.h"
 #include "gen/funcgenstate.h"
 #include "gen/irstate.h"
 #include "gen/llvm.h"
 #include "gen/llvmhelpers.h"
 #include "gen/logger.h"
+#include "gen/optimizer.h"
 #include "gen/runtime.h"
 #include "gen/tollvm.h"
 #include "ir/irfunction.h"
 #include "ir/irmodule.h"
 #include <llvm/Analysis/ConstantFolding.h>
 #include <llvm/IR/Constant.h>
+#include <llvm/IR/MDBuilder.h>
 
 using namespace dmd;
 
@@ -174,6 +178,7 @@ static void copySlice(const Loc &loc, LLValue *dstarr, LLValue *dstlen,
     gIR->CreateCallOrInvoke(
         fn, {dstarr, dstlen, srcarr, srclen, DtoConstSize_t(elementSize)}, "",
         /*isNothrow=*/true);
+    DtoGCMarkCards(dstarr, computeSize(dstlen, elementSize));
   } else {
     // We might have dstarr == srcarr at compile time, but as long as
     // sz1 == 0 at runtime, this would probably still be legal (the C spec
@@ -691,6 +696,61 @@ DSliceValue *DtoNewDynArray(const Loc &loc, Type *arrayType, DValue *dim,
 
 ////////////////////////////////////////////////////////////////////////////////
 
+static llvm::cl::opt<llvm::cl::boolOrDefault, false,
+                     opts::FlagParser<llvm::cl::boolOrDefault>>
+    fusedRectArrays(
+        "fused-rect-arrays", llvm::cl::ZeroOrMore,
+        llvm::cl::desc("(*) Allocate the rows of `new T[][](rows, cols)` as "
+                       "a single block (default when optimizing)"));
+
+bool DtoIsFusableRectDynArray(Type *arrayType) {
+  if (!getFlagOrDefault(fusedRectArrays, isOptimizationEnabled()) ||
+      !global.params.useTypeInfo || !Type::dtypeinfo ||
+      global.params.tracegc) {
+    return false;
+  }
+
+  Type *rowType = arrayType->toBasetype()->nextOf();
+  if (rowType->toBasetype()->ty != TY::Tarray)
+    return false;
+  Type *eltType = rowType->toBasetype()->nextOf();
+
+  // Leave shared arrays and elements requiring finalization to druntime.
+  return !rowType->isShared() && !eltType->isShared() && eltType->size() != 0 &&
+         !eltType->needsDestruction();
+}
+
+DSliceValue *DtoNewRectDynArray(const Loc &loc, Type *arrayType, DValue *rows,
+                                DValue *cols) {
+  IF_LOG Logger::println("DtoNewRectDynArray : %s", arrayType->toChars());
+  LOG_SCOPE;
+
+  Type *rowType = arrayType->toBasetype()->nextOf();
+  Type *eltType = rowType->toBasetype()->nextOf();
+
+  // get runtime function
+  const char *fnname =
+      eltType->isZeroInit() ? "_d_newarraymRectT" : "_d_newarraymRectiT";
+  LLFunction *fn = getRuntimeFunction(loc, gIR->module, fnname);
+
+  // typeinfo arg
+  LLValue *rowTypeInfo = DtoTypeInfoOf(loc, rowType);
+
+  // dim args
+  LLValue *numRows = DtoRVal(rows);
+  LLValue *numCols = DtoRVal(cols);
+
+  // call allocator
+  LLValue *newArray = gIR->CreateCallOrInvoke(fn, rowTypeInfo, numRows,
+                                              numCols, ".gc_mem");
+
+  auto ptr =
+      DtoBitCast(DtoExtractValue(newArray, 1, ".ptr"), DtoPtrToType(rowType));
+  return new DSliceValue(arrayType, numRows, ptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 DSliceValue *DtoAppendDChar(const Loc &loc, DValue *arr, Expression *exp,
                             const char *func) {
   LLValue *valueToAppend = DtoRVal(exp);
@@ -725,6 +785,189 @@ DSliceValue *DtoAppendDCharToUnicodeString(const Loc &loc, DValue *arr,
   return DtoAppendDChar(loc, arr, exp, "_d_arrayappendwd");
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+static llvm::cl::opt<llvm::cl::boolOrDefault, false,
+                     opts::FlagParser<llvm::cl::boolOrDefault>>
+    inlineArrayAppends(
+        "inline-array-appends", llvm::cl::ZeroOrMore,
+        llvm::cl::desc("(*) Append to arrays inline while the capacity "
+                       "cached from a previous append suffices (default "
+                       "when optimizing)"));
+
+namespace {
+// Mirrors rt.lifetime.ArrayAppendCache.
+enum ArrayAppendCacheFields {
+  AAC_End,       // end of the array the cache is valid for
+  AAC_Limit,     // end of the usable capacity of its GC block
+  AAC_Used,      // address of the block's used-length field
+  AAC_UsedValue, // expected value of the used-length field
+  AAC_UsedSize,  // byte size of the used-length field, 0 if not cached
+
+  AAC_NumFields
+};
+
+LLStructType *getArrayAppendCacheType() {
+  auto voidPtrTy = getVoidPtrType();
+  auto sizeTy = DtoSize_t();
+  return LLStructType::get(gIR->context(),
+                           {voidPtrTy, voidPtrTy, voidPtrTy, sizeTy, sizeTy});
+}
+
+/// Returns the zero-initialized capacity cache of the given array variable for
+/// the current function.
+LLValue *getArrayAppendCache(VarDeclaration *vd) {
+  auto &caches = gIR->funcGen().arrayAppendCaches;
+  auto it = caches.find(vd);
+  if (it != caches.end())
+    return it->second;
+
+  auto type = getArrayAppendCacheType();
+  auto cache = DtoRawAlloca(type, 0, ".appendcache");
+  new llvm::StoreInst(getNullValue(type), cache, gIR->topallocapoint());
+  caches[vd] = cache;
+  return cache;
+}
+
+/// Returns the array variable appended to if the given call is an
+/// `object._d_arrayappendcTX(arr, n)` hook call which may be emitted inline.
+VarDeclaration *getInlinableArrayAppend(FuncDeclaration *fd, CallExp *e) {
+  if (fd->ident != Id::_d_arrayappendcTX || !fd->isInstantiated() ||
+      !e->arguments || e->arguments->length != 2)
+    return nullptr;
+
+  if (!getFlagOrDefault(inlineArrayAppends, isOptimizationEnabled()) ||
+      !global.params.useTypeInfo || !Type::dtypeinfo)
+    return nullptr;
+
+  Expression *arr = (*e->arguments)[0];
+  auto ve = arr->isVarExp();
+  if (!ve)
+    return nullptr;
+  auto vd = ve->var->isVarDeclaration();
+  if (!vd)
+    return nullptr;
+
+  // Shared arrays update the used length of their block atomically, and
+  // arrays of structs with destructors store their TypeInfo in the block; leave
+  // both to the runtime.
+  Type *arrayType = arr->type;
+  Type *elemType = arrayType->toBasetype()->nextOf()->toBasetype();
+  if (arrayType->isShared() || elemType->size() == 0 ||
+      elemType->needsDestruction())
+    return nullptr;
+
+  return vd;
+}
+}
+
+bool DtoLowerArrayAppendHook(const Loc &loc, FuncDeclaration *fd, CallExp *e,
+                             DValue *&result) {
+  VarDeclaration *vd = getInlinableArrayAppend(fd, e);
+  if (!vd)
+    return false;
+
+  IF_LOG Logger::println("DtoLowerArrayAppendHook: %s", e->toChars());
+  LOG_SCOPE;
+
+  Expression *arrExp = (*e->arguments)[0];
+  Type *arrayType = arrExp->type;
+  Type *elemType = arrayType->toBasetype()->nextOf()->toBasetype();
+
+  DValue *arr = toElem(arrExp);
+  LLValue *n = DtoRVal((*e->arguments)[1]);
+
+  LLType *i8Ty = getI8Type();
+  LLType *sizeTy = DtoSize_t();
+  LLStructType *cacheTy = getArrayAppendCacheType();
+  LLValue *cache = getArrayAppendCache(vd);
+
+  LLValue *arrLVal = DtoLVal(arr);
+  LLValue *length = DtoArrayLen(arr);
+  LLValue *ptr = DtoBitCast(DtoArrayPtr(arr), getVoidPtrType());
+  LLValue *elemSize = DtoConstSize_t(getTypeAllocSize(DtoMemType(elemType)));
+  LLValue *nbytes = gIR->ir->CreateMul(n, elemSize);
+  LLValue *end =
+      DtoGEP1(i8Ty, ptr, gIR->ir->CreateMul(length, elemSize), ".end");
+
+  // The cache is valid if this array still ends where the cached one did, and
+  // the remaining capacity suffices for the new elements.
+  LLValue *cachedEnd = DtoLoad(
+      getVoidPtrType(), DtoGEP(cacheTy, cache, 0u, AAC_End), ".cachedEnd");
+  LLValue *limit = DtoLoad(getVoidPtrType(),
+                           DtoGEP(cacheTy, cache, 0u, AAC_Limit), ".limit");
+  LLValue *capacity =
+      gIR->ir->CreateSub(gIR->ir->CreatePtrToInt(limit, sizeTy),
+                         gIR->ir->CreatePtrToInt(end, sizeTy));
+  LLValue *isCached =
+      gIR->ir->CreateAnd(gIR->ir->CreateICmpEQ(end, cachedEnd),
+                         gIR->ir->CreateICmpUGE(capacity, nbytes));
+
+  llvm::BasicBlock *checkUsedBB = gIR->insertBB("append.checkUsed");
+  llvm::BasicBlock *fastBB = gIR->insertBBAfter(checkUsedBB, "append.fast");
+  llvm::BasicBlock *slowBB = gIR->insertBBAfter(fastBB, "append.slow");
+  llvm::BasicBlock *endBB = gIR->insertBBAfter(slowBB, "append.end");
+
+  llvm::MDBuilder mdBuilder(gIR->context());
+  gIR->ir->CreateCondBr(isCached, checkUsedBB, slowBB,
+                        mdBuilder.createBranchWeights(2000, 1));
+
+  // The used length stored in the block must still be the one of this array,
+  // i.e., nobody else has appended in the meantime. Its size depends on the
+  // size of the block (see rt.lifetime.__setArrayAllocLength).
+  gIR->ir->SetInsertPoint(checkUsedBB);
+  LLValue *used = DtoLoad(getVoidPtrType(),
+                          DtoGEP(cacheTy, cache, 0u, AAC_Used), ".used");
+  LLValue *usedValue = DtoLoad(
+      sizeTy, DtoGEP(cacheTy, cache, 0u, AAC_UsedValue), ".usedValue");
+  LLValue *usedSize = DtoLoad(
+      sizeTy, DtoGEP(cacheTy, cache, 0u, AAC_UsedSize), ".usedSize");
+  LLValue *newUsedValue = gIR->ir->CreateAdd(usedValue, nbytes);
+  auto sw = gIR->ir->CreateSwitch(usedSize, slowBB, 3);
+  for (LLIntegerType *fieldTy : {LLType::getInt8Ty(gIR->context()),
+                                 LLType::getInt16Ty(gIR->context()),
+                                 DtoSize_t()}) {
+    const auto fieldSize = getTypeStoreSize(fieldTy);
+    auto loadBB = gIR->insertBBBefore(fastBB, "append.used");
+    auto storeBB = gIR->insertBBBefore(fastBB, "append.setUsed");
+    sw->addCase(DtoConstSize_t(fieldSize), loadBB);
+
+    gIR->ir->SetInsertPoint(loadBB);
+    LLValue *field = DtoBitCast(used, fieldTy->getPointerTo());
+    LLValue *current = DtoLoad(fieldTy, field);
+    LLValue *expected = gIR->ir->CreateTrunc(usedValue, fieldTy);
+    gIR->ir->CreateCondBr(gIR->ir->CreateICmpEQ(current, expected), storeBB,
+                          slowBB, mdBuilder.createBranchWeights(2000, 1));
+
+    gIR->ir->SetInsertPoint(storeBB);
+    DtoStore(gIR->ir->CreateTrunc(newUsedValue, fieldTy), field);
+    gIR->ir->CreateBr(fastBB);
+  }
+
+  // Fast path: bump the array length and update the cache.
+  gIR->ir->SetInsertPoint(fastBB);
+  LLType *arrTy = DtoType(arrayType);
+  DtoStore(gIR->ir->CreateAdd(length, n), DtoGEP(arrTy, arrLVal, 0u, 0u));
+  DtoStore(DtoGEP1(i8Ty, end, nbytes), DtoGEP(cacheTy, cache, 0u, AAC_End));
+  DtoStore(newUsedValue, DtoGEP(cacheTy, cache, 0u, AAC_UsedValue));
+  gIR->ir->CreateBr(endBB);
+
+  // Slow path: let the runtime append and refill the cache.
+  gIR->ir->SetInsertPoint(slowBB);
+  LLFunction *fn =
+      getRuntimeFunction(loc, gIR->module, "_d_arrayappendcTXCached");
+  LLFunctionType *fnTy = fn->getFunctionType();
+  gIR->CreateCallOrInvoke(
+      fn, {DtoTypeInfoOf(loc, arrayType),
+           DtoBitCast(arrLVal, fnTy->getParamType(1)), n, DtoConstSize_t(0),
+           DtoBitCast(cache, fnTy->getParamType(4))});
+  gIR->ir->CreateBr(endBB);
+
+  gIR->ir->SetInsertPoint(endBB);
+  result = new DLValue(e->type, arrLVal);
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 namespace {
 // helper for eq and cmp
@@ -18,9 +18,11 @@
 
 class ArrayInitializer;
 class ArrayLiteralExp;
+class CallExp;
 class DSliceValue;
 class DValue;
 class Expression;
+class FuncDeclaration;
 struct IRState;
 struct Loc;
 class Type;
@@ -62,9 +64,21 @@ void DtoSetArrayToNull(DValue *v);
 
 DSliceValue *DtoNewDynArray(const Loc &loc, Type *arrayType, DValue *dim,
                             bool defaultInit = true);
+/// Returns whether `new T[][](rows, cols)` can be allocated via
+/// DtoNewRectDynArray().
+bool DtoIsFusableRectDynArray(Type *arrayType);
+/// Allocates the rows of a rectangular 2-dimensional array in a single block,
+/// returning the table of row slices.
+DSliceValue *DtoNewRectDynArray(const Loc &loc, Type *arrayType, DValue *rows,
+                                DValue *cols);
 
 DSliceValue *DtoCatArrays(const Loc &loc, Type *type, Expression *e1,
                           Expression *e2);
+/// Emits an `object._d_arrayappendcTX(arr, n)` hook call inline if possible,
+/// extending `arr` in place while the capacity cached from a previous append
+/// suffices. Returns false if the call needs to be emitted normally.
+bool DtoLowerArrayAppendHook(const Loc &loc, FuncDeclaration *fd, CallExp *e,
+                             DValue *&result);
 DSliceValue *DtoAppendDCharToString(const Loc &loc, DValue *arr,
                                     Expression *exp);
 DSliceValue *DtoAppendDCharToUnicodeString(const Loc &loc, DValue *arr,
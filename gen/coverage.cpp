@@ -13,6 +13,7 @@
 #include "driver/cl_options.h"
 #include "gen/irstate.h"
 #include "gen/logger.h"
+#include "ir/irmodule.h"
 
 void emitCoverageLinecountInc(const Loc &loc) {
   Module *m = gIR->dmodule;
@@ -39,6 +40,19 @@ void emitCoverageLinecountInc(const Loc &loc) {
       LLArrayType::get(i32Type, m->numlines), m->d_cover_data, idxs, true);
   // ...and generate the "increment" instruction(s)
   switch (opts::coverageIncrement) {
+  case opts::CoverageIncrement::sharded: {
+    // Do a non-atomic increment of this thread's counter, which is private
+    // to the thread and merged into _d_cover_data by druntime
+    auto shard = getIrModule(m)->coverageShard;
+    assert(shard);
+    LLValue *shardPtr = llvm::ConstantExpr::getGetElementPtr(
+        shard->getValueType(), shard, idxs, true);
+    llvm::LoadInst *load =
+        gIR->ir->CreateAlignedLoad(i32Type, shardPtr, llvm::Align(4));
+    gIR->ir->CreateAlignedStore(gIR->ir->CreateAdd(load, DtoConstUint(1)),
+                                shardPtr, llvm::Align(4));
+    break;
+  }
   case opts::CoverageIncrement::_default: // fallthrough
   case opts::CoverageIncrement::atomic:
     // Do an atomic increment, so this works when multiple threads are executed.
@@ -24,6 +24,7 @@
 class Identifier;
 struct IRState;
 class Statement;
+class VarDeclaration;
 
 namespace llvm {
 class AllocaInst;
@@ -200,6 +201,10 @@ public:
   /// value.
   llvm::AllocaInst *retValSlot = nullptr;
 
+  /// Stack slots caching the block capacity of arrays appended to in this
+  /// function (see rt.lifetime.ArrayAppendCache), by array variable.
+  llvm::DenseMap<VarDeclaration *, llvm::AllocaInst *> arrayAppendCaches;
+
   /// Emits a call or invoke to the given callee, depending on whether there
   /// are catches/cleanups active or not.
   llvm::CallBase *callOrInvoke(llvm::Value *callee,
@@ -53,6 +53,8 @@
 #include "ir/irdsymbol.h"
 #include "ir/irfunction.h"
 #include "ir/irmodule.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/Target/TargetMachine.h"
@@ -861,6 +863,33 @@ void emitDMDStyleFunctionTrace(IRState &irs, FuncDeclaration *fd,
    *     _c_trace_epi();
    */
 
+  if (opts::dmdFunctionTraceBuffered) {
+    /* Buffered variant, identifying the function by the address of a private
+     * constant holding its name:
+     *   _d_trace_enter(&id);
+     *   try
+     *     body;
+     *   finally
+     *     _d_trace_exit(&id);
+     */
+    auto id = new llvm::GlobalVariable(
+        irs.module, DtoType(Type::tstring), /*isConstant=*/true,
+        LLGlobalValue::PrivateLinkage, DtoConstString(mangleExact(fd)),
+        ".dtrace.id");
+    auto idPtr = DtoBitCast(id, getVoidPtrType());
+
+    irs.ir->CreateCall(getRuntimeFunction(fd->loc, irs.module, "_d_trace_enter"),
+                       idPtr);
+
+    auto traceExitBB = irs.insertBB("trace_exit");
+    const auto savedInsertPoint = irs.saveInsertPoint();
+    irs.ir->SetInsertPoint(traceExitBB);
+    irs.ir->CreateCall(
+        getRuntimeFunction(fd->endloc, irs.module, "_d_trace_exit"), idPtr);
+    funcGen.scopes.pushCleanup(traceExitBB, irs.scopebb());
+    return;
+  }
+
   // Call trace_pro("funcname")
   {
     auto fn = getRuntimeFunction(fd->loc, irs.module, "trace_pro");
@@ -879,6 +908,35 @@ void emitDMDStyleFunctionTrace(IRState &irs, FuncDeclaration *fd,
   }
 }
 
+// Removes the DMD-style tracing calls again if the function has fewer than
+// -fdmd-trace-instruction-threshold other instructions.
+void removeSmallFunctionTrace(llvm::Function *func) {
+  static const char *const traceFuncs[] = {"trace_pro", "_c_trace_epi",
+                                           "_d_trace_enter", "_d_trace_exit"};
+  const auto isTraceCall = [](llvm::Instruction &inst) {
+    auto call = llvm::dyn_cast<llvm::CallInst>(&inst);
+    auto callee = call ? call->getCalledFunction() : nullptr;
+    return callee && llvm::is_contained(traceFuncs, callee->getName());
+  };
+
+  unsigned numInstructions = 0;
+  llvm::SmallVector<llvm::Instruction *, 8> traceCalls;
+  for (auto &inst : llvm::instructions(func)) {
+    if (isTraceCall(inst)) {
+      traceCalls.push_back(&inst);
+    } else if (!llvm::isa<llvm::DbgInfoIntrinsic>(inst)) {
+      ++numInstructions;
+    }
+  }
+
+  if (numInstructions < opts::dmdFunctionTraceThreshold) {
+    IF_LOG Logger::println("Removing tracing of small function (%u instructions)",
+                           numInstructions);
+    for (auto inst : traceCalls)
+      inst->eraseFromParent();
+  }
+}
+
 // If the specified block is trivially unreachable, erases it and returns true.
 // This is a common case because it happens when 'return' is the last statement
 // in a function.
@@ -1347,6 +1405,10 @@ void DtoDefineFunction(FuncDeclaration *fd, bool linkageAvailableExternally) {
     allocaPoint = nullptr;
   }
 
+  if (global.params.trace && opts::dmdFunctionTraceThreshold > 0) {
+    removeSmallFunctionTrace(func);
+  }
+
   if (gIR->dcomputetarget && hasKernelAttr(fd)) {
     auto fn = gIR->module.getFunction(fd->mangleString);
     gIR->dcomputetarget->addKernelMetadata(fd, fn);
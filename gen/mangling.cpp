@@ -119,14 +119,9 @@ std::string getIRMangledName(FuncDeclaration *fdecl, LINK link) {
 }
 
 std::string getIRMangledName(VarDeclaration *vd) {
-  OutBuffer mangleBuf;
-  mangleToBuffer(vd, mangleBuf);
-
   // TODO: is hashing of variable names necessary?
 
-  // TODO: Cache the result?
-
-  return getIRMangledVarName(mangleBuf.peekChars(), vd->resolvedLinkage());
+  return getIRMangledVarName(mangleCached(vd), vd->resolvedLinkage());
 }
 
 std::string getIRMangledFuncName(std::string baseMangle, LINK link) {
@@ -145,9 +140,7 @@ std::string getIRMangledAggregateName(AggregateDeclaration *ad,
                                       const char *suffix) {
   std::string ret = "_D";
 
-  OutBuffer mangleBuf;
-  mangleToBuffer(ad, mangleBuf);
-  llvm::StringRef mangledAggrName = mangleBuf.peekChars();
+  llvm::StringRef mangledAggrName = mangleCached(ad);
 
   if (shouldHashAggrName(mangledAggrName)) {
     ret += hashSymbolName(mangledAggrName, ad);
@@ -176,19 +169,15 @@ std::string getIRMangledClassInfoSymbolName(AggregateDeclaration *aggrdecl) {
 }
 
 std::string getIRMangledInterfaceInfosSymbolName(ClassDeclaration *cd) {
-  OutBuffer mangledName;
-  mangledName.writestring("_D");
-  mangleToBuffer(cd, mangledName);
-  mangledName.writestring("16__interfaceInfosZ");
-  return getIRMangledVarName(mangledName.peekChars(), LINK::d);
+  return getIRMangledVarName(
+      (llvm::Twine("_D") + mangleCached(cd) + "16__interfaceInfosZ").str(),
+      LINK::d);
 }
 
 std::string getIRMangledModuleInfoSymbolName(Module *module) {
-  OutBuffer mangledName;
-  mangledName.writestring("_D");
-  mangleToBuffer(module, mangledName);
-  mangledName.writestring("12__ModuleInfoZ");
-  return getIRMangledVarName(mangledName.peekChars(), LINK::d);
+  return getIRMangledVarName(
+      (llvm::Twine("_D") + mangleCached(module) + "12__ModuleInfoZ").str(),
+      LINK::d);
 }
 
 std::string getIRMangledModuleRefSymbolName(const char *moduleMangle) {
@@ -12,6 +12,7 @@
 #include "dmd/errors.h"
 #include "dmd/mangle.h"
 #include "dmd/module.h"
+#include "driver/cl_options.h"
 #include "gen/abi/abi.h"
 #include "gen/classes.h"
 #include "gen/irstate.h"
@@ -35,6 +36,7 @@
 #define MIunitTest 0x200
 #define MIimportedModules 0x400
 #define MIlocalClasses 0x800
+#define MIgcWriteBarriers 0x2000
 #define MInew 0x80000000 // it's the "new" layout
 
 using namespace dmd;
@@ -286,6 +288,11 @@ llvm::GlobalVariable *genModuleInfo(Module *m) {
     flags |= MIstandalone;
   }
 
+  // the generational GC mode requires all modules to be compiled with barriers
+  if (opts::gcWriteBarriers) {
+    flags |= MIgcWriteBarriers;
+  }
+
   // Now, start building the initialiser for the ModuleInfo instance.
   RTTIBuilder b(moduleInfoType);
 
@@ -339,3 +346,81 @@ llvm::GlobalVariable *genModuleInfo(Module *m) {
   }
   return moduleInfoSym;
 }
+
+void genNoScanData(Module *m) {
+  IrModule *irm = getIrModule(m);
+  if (irm->noScanGlobals.empty()) {
+    return;
+  }
+
+  auto &ctx = gIR->context();
+  const auto voidPtrTy = getVoidPtrType();
+  const auto rangeTy = LLStructType::get(ctx, {voidPtrTy, DtoSize_t()});
+
+  std::vector<LLConstant *> ranges;
+  std::vector<LLGlobalVariable *> tlsVars;
+  std::vector<LLConstant *> tlsSizes;
+  for (auto vd : irm->noScanGlobals) {
+    auto gvar =
+        llvm::cast<LLGlobalVariable>(getIrValue(vd)->stripPointerCasts());
+    const auto size = getTypeAllocSize(gvar->getValueType());
+    if (size == 0) {
+      continue;
+    }
+    if (gvar->isThreadLocal()) {
+      tlsVars.push_back(gvar);
+      tlsSizes.push_back(DtoConstSize_t(size));
+    } else {
+      ranges.push_back(llvm::ConstantStruct::get(
+          rangeTy, {DtoBitCast(gvar, voidPtrTy), DtoConstSize_t(size)}));
+    }
+  }
+
+  // The static (address, size) pairs of all modules are concatenated by the
+  // linker into the __d_noscan section.
+  if (!ranges.empty()) {
+    const auto arrayTy = llvm::ArrayType::get(rangeTy, ranges.size());
+    auto data = defineGlobal(Loc(), gIR->module, "_d_noscan_data",
+                             llvm::ConstantArray::get(arrayTy, ranges),
+                             LLGlobalValue::PrivateLinkage, false, false);
+    data->setAlignment(llvm::MaybeAlign(getABITypeAlign(rangeTy)));
+    data->setSection("__d_noscan");
+    gIR->usedArray.push_back(data);
+  }
+
+  // TLS addresses aren't link-time constants, so emit a function storing the
+  // addresses of the executing thread's instances, and a record
+  // { getAddrs, count, sizes } into the __d_noscan_tls section.
+  if (!tlsVars.empty()) {
+    const auto fnTy = LLFunctionType::get(LLType::getVoidTy(ctx),
+                                          {voidPtrTy->getPointerTo()}, false);
+    auto getAddrs =
+        llvm::Function::Create(fnTy, LLGlobalValue::InternalLinkage,
+                               "_d_noscan_tls_addrs", &gIR->module);
+    getAddrs->addFnAttr(llvm::Attribute::NoUnwind);
+    IRBuilder<> builder(llvm::BasicBlock::Create(ctx, "", getAddrs));
+    const auto addrs = getAddrs->arg_begin();
+    for (size_t i = 0; i < tlsVars.size(); ++i) {
+      const auto slot = builder.CreateConstInBoundsGEP1_64(voidPtrTy, addrs, i);
+      builder.CreateStore(DtoBitCast(tlsVars[i], voidPtrTy), slot);
+    }
+    builder.CreateRetVoid();
+
+    const auto sizesTy = llvm::ArrayType::get(DtoSize_t(), tlsSizes.size());
+    auto sizes = defineGlobal(Loc(), gIR->module, "_d_noscan_tls_sizes",
+                              llvm::ConstantArray::get(sizesTy, tlsSizes),
+                              LLGlobalValue::PrivateLinkage, true, false);
+
+    const auto sizesPtrTy = DtoSize_t()->getPointerTo();
+    const auto recordTy = LLStructType::get(
+        ctx, {getAddrs->getType(), DtoSize_t(), sizesPtrTy});
+    const auto record = llvm::ConstantStruct::get(
+        recordTy, {getAddrs, DtoConstSize_t(tlsVars.size()),
+                   DtoBitCast(sizes, sizesPtrTy)});
+    auto tls = defineGlobal(Loc(), gIR->module, "_d_noscan_tls", record,
+                            LLGlobalValue::PrivateLinkage, false, false);
+    tls->setAlignment(llvm::MaybeAlign(getABITypeAlign(recordTy)));
+    tls->setSection("__d_noscan_tls");
+    gIR->usedArray.push_back(tls);
+  }
+}
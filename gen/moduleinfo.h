@@ -18,3 +18,8 @@ class Module;
 /// Note that this just creates data itself, and is not concerned with emitting
 /// a reference pointing to it to register the module with the runtime.
 llvm::GlobalVariable *genModuleInfo(Module *m);
+
+/// Emits the pointer-free mutable globals of the given module (see
+/// -fprecise-data-scan) into the special __d_noscan and __d_noscan_tls
+/// sections, to be excluded from GC scanning of the data and TLS segments.
+void genNoScanData(Module *m);
@@ -22,6 +22,7 @@
 #include "dmd/statement.h"
 #include "dmd/target.h"
 #include "dmd/template.h"
+#include "driver/cl_options.h"
 #include "driver/cl_options_instrumentation.h"
 #include "driver/timetrace.h"
 #include "gen/abi/abi.h"
@@ -277,6 +278,33 @@ void addCoverageAnalysis(Module *m) {
                                               m->d_cover_data, 0, 0));
   }
 
+  // With -cov-increment=sharded, each thread counts into its own copy
+  // uint[# source lines] _d_cover_shard, which druntime merges into
+  // _d_cover_data when the thread terminates. druntime can't take the address
+  // of another module's TLS variable, so hand it an accessor function.
+  LLValue *shardGetter = nullptr;
+  if (opts::coverageIncrement == opts::CoverageIncrement::sharded) {
+    IF_LOG Logger::println(
+        "Build private TLS variable: uint[%d] _d_cover_shard", m->numlines);
+
+    LLArrayType *type =
+        LLArrayType::get(LLType::getInt32Ty(gIR->context()), m->numlines);
+    auto shard = defineGlobal(Loc(), gIR->module, "_d_cover_shard",
+                              llvm::ConstantAggregateZero::get(type),
+                              LLGlobalValue::InternalLinkage, false, true);
+
+    auto getterTy = LLFunctionType::get(getVoidPtrType(), {}, false);
+    auto getter = LLFunction::Create(getterTy, LLGlobalValue::InternalLinkage,
+                                     "_d_cover_shard_get", &gIR->module);
+    getter->setCallingConv(gABI->callingConv(LINK::c));
+    getter->addFnAttr(LLAttribute::NoUnwind);
+    IRBuilder<> builder(llvm::BasicBlock::Create(gIR->context(), "", getter));
+    builder.CreateRet(builder.CreateBitCast(shard, getVoidPtrType()));
+
+    shardGetter = DtoBitCast(getter, getVoidPtrType());
+    getIrModule(m)->coverageShard = shard;
+  }
+
   // Create "static constructor" that calls _d_cover_register2(string filename,
   // size_t[] valid, uint[] data, ubyte minPercent)
   // Build ctor name
@@ -309,14 +337,18 @@ void addCoverageAnalysis(Module *m) {
     llvm::BasicBlock *bb = llvm::BasicBlock::Create(gIR->context(), "", ctor);
     IRBuilder<> builder(bb);
 
-    // Set up call to _d_cover_register2
-    llvm::Function *fn =
-        getRuntimeFunction(Loc(), gIR->module, "_d_cover_register2");
-    LLValue *args[] = {DtoConstString(m->srcfile.toChars()),
-                       d_cover_valid_slice, d_cover_data_slice,
-                       DtoConstUbyte(global.params.covPercent)};
+    // Set up call to _d_cover_register2, or _d_cover_register3 with the
+    // shard accessor as additional argument
+    llvm::Function *fn = getRuntimeFunction(
+        Loc(), gIR->module,
+        shardGetter ? "_d_cover_register3" : "_d_cover_register2");
+    llvm::SmallVector<LLValue *, 5> args = {
+        DtoConstString(m->srcfile.toChars()), d_cover_valid_slice,
+        d_cover_data_slice, DtoConstUbyte(global.params.covPercent)};
+    if (shardGetter)
+      args.push_back(shardGetter);
     // Check if argument types are correct
-    for (unsigned i = 0; i < 4; ++i) {
+    for (unsigned i = 0; i < args.size(); ++i) {
       assert(args[i]->getType() == fn->getFunctionType()->getParamType(i));
     }
 
@@ -400,6 +432,11 @@ void registerModuleInfo(Module *m) {
     AppendFunctionToLLVMGlobalCtorsDtors(miCtor, 65535, true);
   } else {
     emitModuleRefToSection(mangle, moduleInfoSym);
+    // only rt.sections_elf_shared knows how to pick up the pointer-free ranges
+    if (opts::fPreciseDataScan &&
+        global.params.targetTriple->isOSBinFormatELF()) {
+      genNoScanData(m);
+    }
   }
 }
 
@@ -17,6 +17,7 @@
 #include "gen/irstate.h"
 #include "gen/llvmhelpers.h"
 #include "gen/logger.h"
+#include "gen/passes/metadata.h"
 #include "gen/runtime.h"
 #include "gen/tollvm.h"
 #include "ir/irfunction.h"
@@ -504,9 +505,18 @@ void DtoCreateNestedContext(FuncGenState &funcGen) {
       auto size = getTypeAllocSize(frameType);
       if (frameAlignment > 16) // GC guarantees an alignment of 16
         size += frameAlignment - 16;
-      LLValue *mem =
+      llvm::Instruction *call =
           gIR->CreateCallOrInvoke(fn, DtoConstSize_t(size), ".gc_frame");
+      LLValue *mem = call;
       if (frameAlignment <= 16) {
+        // Let the GarbageCollect2Stack pass know that this is a closure frame,
+        // which can live on the stack if no delegate escapes after inlining.
+        auto alignment = LLConstantInt::get(LLType::getInt32Ty(gIR->context()),
+                                            frameAlignment);
+        call->setMetadata(CLOSURE_MD,
+                          llvm::MDNode::get(gIR->context(),
+                                            llvm::ConstantAsMetadata::get(
+                                                alignment)));
         frame = DtoBitCast(mem, frameType->getPointerTo(), ".frame");
       } else {
         const uint64_t mask = frameAlignment - 1;
@@ -12,6 +12,7 @@
 #include "dmd/errors.h"
 #include "gen/logger.h"
 #include "gen/passes/GarbageCollect2Stack.h"
+#include "gen/passes/HoistBoundsChecks.h"
 #include "gen/passes/StripExternals.h"
 #include "gen/passes/SimplifyDRuntimeCalls.h"
 #include "gen/passes/Passes.h"
@@ -98,6 +99,10 @@ static cl::opt<bool> disableGCToStack(
     "disable-gc2stack", cl::ZeroOrMore,
     cl::desc("Disable promotion of GC allocations to stack memory"));
 
+static cl::opt<bool> disableBoundsCheckHoisting(
+    "disable-bounds-check-hoisting", cl::ZeroOrMore,
+    cl::desc("Disable hoisting of array bounds checks out of loops"));
+
 static cl::opt<cl::boolOrDefault, false, opts::FlagParser<cl::boolOrDefault>>
     enableInlining(
         "inlining", cl::ZeroOrMore,
@@ -197,6 +202,13 @@ static void legacyAddGarbageCollect2StackPass(const PassManagerBuilder &builder,
   }
 }
 
+static void legacyAddHoistBoundsChecksPass(const PassManagerBuilder &builder,
+                                          PassManagerBase &pm) {
+  if (builder.OptLevel >= 2 && builder.SizeLevel == 0) {
+    legacyAddPass(pm, createHoistBoundsChecksPass());
+  }
+}
+
 static void legacyAddAddressSanitizerPasses(const PassManagerBuilder &Builder,
                                             PassManagerBase &PM) {
   PM.add(createAddressSanitizerFunctionPass(/*CompileKernel = */ false,
@@ -342,6 +354,11 @@ static void legacyAddOptimizationPasses(legacy::PassManagerBase &mpm,
       builder.addExtension(PassManagerBuilder::EP_LoopOptimizerEnd,
                            legacyAddGarbageCollect2StackPass);
     }
+
+    if (!disableBoundsCheckHoisting) {
+      builder.addExtension(PassManagerBuilder::EP_VectorizerStart,
+                           legacyAddHoistBoundsChecksPass);
+    }
   }
 
   // EP_OptimizerLast does not exist in LLVM 3.0, add it manually below.
@@ -554,6 +571,15 @@ static void addGarbageCollect2StackPass(ModulePassManager &mpm,
   }
 }
 
+static void addHoistBoundsChecksPass(FunctionPassManager &fpm,
+                                     OptimizationLevel level) {
+  if (level == OptimizationLevel::O2 || level == OptimizationLevel::O3) {
+    fpm.addPass(HoistBoundsChecksPass());
+    if (verifyEach) {
+      fpm.addPass(VerifierPass());
+    }
+  }
+}
 
 static llvm::Optional<PGOOptions> getPGOOptions() {
   // FIXME: Do we have these anywhere?
@@ -719,6 +745,10 @@ void runOptimizationPasses(llvm::Module *M) {
       //(had registerLoopOptimizerEndEPCallback) but that seems wrong
       pb.registerOptimizerLastEPCallback(addGarbageCollect2StackPass);
     }
+    if (!disableBoundsCheckHoisting) {
+      // Run right before the loop vectorizer, which is what we enable.
+      pb.registerVectorizerStartEPCallback(addHoistBoundsChecksPass);
+    }
   }
 
   pb.registerOptimizerLastEPCallback(addStripExternalsPass);
@@ -820,6 +850,7 @@ void outputOptimizationSettings(llvm::raw_ostream &hash_os) {
   hash_os << disableSimplifyDruntimeCalls;
   hash_os << disableSimplifyLibCalls;
   hash_os << disableGCToStack;
+  hash_os << disableBoundsCheckHoisting;
   hash_os << stripDebug;
   hash_os << disableLoopUnrolling;
   hash_os << disableLoopVectorization;
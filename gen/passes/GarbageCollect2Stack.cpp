@@ -18,7 +18,9 @@
 #include "gen/runtime.h"
 #include "llvm/Pass.h"
 #include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/CaptureTracking.h"
 #include "llvm/Analysis/ValueTracking.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
@@ -45,6 +47,8 @@ using namespace llvm;
 STATISTIC(NumGcToStack, "Number of calls promoted to constant-size allocas");
 STATISTIC(NumToDynSize,
           "Number of calls promoted to dynamically-sized allocas");
+STATISTIC(NumClosuresToStack,
+          "Number of closure frames promoted to constant-size allocas");
 STATISTIC(NumDeleted,
           "Number of GC calls deleted because the return value was unused");
 
@@ -205,6 +209,63 @@ Value* ArrayFI::promote(CallBase *CB, IRBuilder<> &B, const G2StackAnalysis &A)
 
   return alloca;
 }
+bool RectArrayFI::analyze(CallBase *CB, const G2StackAnalysis &A) {
+  auto Rows = dyn_cast<ConstantInt>(CB->getArgOperand(RowsArgNr));
+  auto Cols = dyn_cast<ConstantInt>(CB->getArgOperand(ColsArgNr));
+  if (!Rows || !Cols) {
+    return false;
+  }
+  NumRows = Rows->getZExtValue();
+  NumCols = Cols->getZExtValue();
+
+  // The TypeInfo is the one of the rows.
+  Ty = A.getTypeFor(CB->getArgOperand(TypeInfoArgNr), 1);
+  if (!Ty) {
+    return false;
+  }
+
+  // The row slices are initialized one by one, so limit their number even if
+  // the user disabled the size limit.
+  const uint64_t MaxRows = 64;
+  if (NumRows > MaxRows || (NumCols && NumRows > UINT32_MAX / NumCols)) {
+    return false;
+  }
+  uint64_t Size = NumRows * A.DL.getTypeAllocSize(CB->getType()) +
+                  NumRows * NumCols * A.DL.getTypeAllocSize(Ty);
+  return SizeLimit == 0 || Size < SizeLimit;
+}
+
+Value* RectArrayFI::promote(CallBase *CB, IRBuilder<> &B, const G2StackAnalysis &A) {
+  NumGcToStack++;
+
+  // Allocate the table of rows and the elements in the entry block...
+  auto RowTy = cast<StructType>(CB->getType());
+  BasicBlock &Entry = CB->getCaller()->getEntryBlock();
+  IRBuilder<> Builder(&Entry, Entry.begin());
+  AllocaInst *Table =
+      Builder.CreateAlloca(RowTy, Builder.getInt32(NumRows), ".nongc_rows");
+  AllocaInst *Data = Builder.CreateAlloca(
+      Ty, Builder.getInt32(NumRows * NumCols), ".nongc_mem");
+
+  // ... and initialize them at the original allocation site.
+  auto SizeTy = cast<IntegerType>(RowTy->getElementType(0));
+  uint64_t Size = NumRows * NumCols * A.DL.getTypeStoreSize(Ty);
+  EmitMemZero(B, Data, ConstantInt::get(SizeTy, Size), A);
+
+  Value *NumColsV = ConstantInt::get(SizeTy, NumCols);
+  for (uint64_t I = 0; I < NumRows; ++I) {
+    Value *RowPtr = B.CreateConstInBoundsGEP1_64(Ty, Data, I * NumCols);
+    RowPtr = B.CreateBitCast(RowPtr, RowTy->getElementType(1));
+    Value *Row = B.CreateInsertValue(UndefValue::get(RowTy), NumColsV, 0);
+    Row = B.CreateInsertValue(Row, RowPtr, 1);
+    B.CreateStore(Row, B.CreateConstInBoundsGEP1_64(RowTy, Table, I));
+  }
+
+  Value *Result = B.CreateInsertValue(UndefValue::get(RowTy),
+                                      ConstantInt::get(SizeTy, NumRows), 0);
+  Value *TablePtr = B.CreateBitCast(Table, RowTy->getElementType(1));
+  return B.CreateInsertValue(Result, TablePtr, 1);
+}
 bool AllocClassFI::analyze(CallBase *CB, const G2StackAnalysis &A) {
   if (CB->arg_size() != 1) {
     return false;
@@ -286,6 +347,36 @@ Value* UntypedMemoryFI::promote(CallBase *CB, IRBuilder<> &B, const G2StackAnaly
 
   return B.CreateBitCast(alloca, CB->getType());
 }
+bool ClosureFI::analyze(CallBase *CB, const G2StackAnalysis &A) {
+  if (!UntypedMemoryFI::analyze(CB, A) || !isa<Constant>(SizeArg)) {
+    return false;
+  }
+
+  MDNode *node = CB->getMetadata(CLOSURE_MD);
+  if (!node || node->getNumOperands() != CL_NumFields) {
+    return false;
+  }
+  auto alignment =
+      mdconst::dyn_extract<ConstantInt>(node->getOperand(CL_Alignment));
+  if (!alignment) {
+    return false;
+  }
+  Alignment = alignment->getZExtValue();
+  return true;
+}
+Value* ClosureFI::promote(CallBase *CB, IRBuilder<> &B, const G2StackAnalysis &A) {
+  NumClosuresToStack++;
+
+  // Closure frames are of constant size, so put them into the entry block,
+  // honoring the frame alignment (which the GC would have guaranteed).
+  BasicBlock &Entry = CB->getCaller()->getEntryBlock();
+  IRBuilder<> Builder(&Entry, Entry.begin());
+  Value *count = Builder.CreateIntCast(SizeArg, Builder.getInt32Ty(), false);
+  AllocaInst *alloca = Builder.CreateAlloca(Ty, count, ".nongc_frame");
+  alloca->setAlignment(llvm::Align(std::max(Alignment, 1u)));
+
+  return Builder.CreateBitCast(alloca, CB->getType());
+}
 //}
 
 //===----------------------------------------------------------------------===//
@@ -340,7 +431,9 @@ FunctionPass *createGarbageCollect2Stack() {
 GarbageCollect2Stack::GarbageCollect2Stack()
     : AllocMemoryT(ReturnType::Pointer, 0),
       NewArrayU(ReturnType::Array, 0, 1, false),
-      NewArrayT(ReturnType::Array, 0, 1, true), AllocMemory(0) {
+      NewArrayT(ReturnType::Array, 0, 1, true), NewRectArrayT(0, 1, 2),
+      AllocMemory(0),
+      AllocClosure(0) {
 }
 
 static void RemoveCall(CallBase *CB, const G2StackAnalysis &A) {
@@ -361,10 +454,13 @@ static void RemoveCall(CallBase *CB, const G2StackAnalysis &A) {
 
 static bool
 isSafeToStackAllocateArray(BasicBlock::iterator Alloc, DominatorTree &DT,
-                           SmallVector<CallInst *, 4> &RemoveTailCallInsts);
+                           SmallVector<CallInst *, 4> &RemoveTailCallInsts,
+                           bool IsRowTable = false);
 static bool
 isSafeToStackAllocate(BasicBlock::iterator Alloc, Value *V, DominatorTree &DT,
-                      SmallVector<CallInst *, 4> &RemoveTailCallInsts);
+                      SmallVector<CallInst *, 4> &RemoveTailCallInsts,
+                      bool AnalyzeCallees = false,
+                      SmallVectorImpl<LoadInst *> *RowLoads = nullptr);
 
 /// runOnFunction - Top level algorithm.
 ///
@@ -405,6 +501,7 @@ bool GarbageCollect2Stack::run(Function &F, std::function<DominatorTree& ()> get
      .Case("_d_allocmemoryT", &AllocMemoryT)
      .Case("_d_newarrayU",    &NewArrayU)
      .Case("_d_newarrayT",    &NewArrayT)
+     .Case("_d_newarraymRectT", &NewRectArrayT)
      .Case("_d_allocclass",   &AllocClass)
      .Case("_d_allocmemory",  &AllocMemory)
      .Default(nullptr);
@@ -414,6 +511,10 @@ bool GarbageCollect2Stack::run(Function &F, std::function<DominatorTree& ()> get
         continue;
       }
 
+      if (info == &AllocMemory && CB->getMetadata(CLOSURE_MD)) {
+        info = &AllocClosure;
+      }
+
       if (static_cast<Instruction *>(CB)->use_empty()) {
         Changed = true;
         NumDeleted++;
@@ -429,11 +530,16 @@ bool GarbageCollect2Stack::run(Function &F, std::function<DominatorTree& ()> get
 
       SmallVector<CallInst *, 4> RemoveTailCallInsts;
       if (info->ReturnType == ReturnType::Array) {
-        if (!isSafeToStackAllocateArray(originalI, DT, RemoveTailCallInsts)) {
+        if (!isSafeToStackAllocateArray(originalI, DT, RemoveTailCallInsts,
+                                        info == &NewRectArrayT)) {
           continue;
         }
       } else {
-        if (!isSafeToStackAllocate(originalI, CB, DT, RemoveTailCallInsts)) {
+        // The context pointer of the nested functions referencing a closure
+        // frame is usually not captured; look into their bodies if that hasn't
+        // been inferred yet.
+        if (!isSafeToStackAllocate(originalI, CB, DT, RemoveTailCallInsts,
+                                   info == &AllocClosure)) {
           continue;
         }
       }
@@ -625,9 +731,13 @@ static bool mayBeUsedAfterRealloc(Instruction *Def, BasicBlock::iterator Alloc,
 ///
 /// This handles GC calls returning a D array instead of a raw pointer,
 /// see isSafeToStackAllocate() for details.
+///
+/// If IsRowTable is set, the array is a table of row slices pointing into
+/// memory allocated by the same call, so the row pointers loaded from it must
+/// not escape either.
 bool isSafeToStackAllocateArray(
     BasicBlock::iterator Alloc, DominatorTree &DT,
-    SmallVector<CallInst *, 4> &RemoveTailCallInsts) {
+    SmallVector<CallInst *, 4> &RemoveTailCallInsts, bool IsRowTable) {
   assert(Alloc->getType()->isStructTy() && "Allocated array is not a struct?");
   Value *V = &(*Alloc);
 
@@ -651,9 +761,17 @@ bool isSafeToStackAllocateArray(
                "First array field not length?");
       } else {
         assert(idx == 1 && "Invalid array struct access.");
-        if (!isSafeToStackAllocate(Alloc, EVI, DT, RemoveTailCallInsts)) {
+        SmallVector<LoadInst *, 16> RowLoads;
+        if (!isSafeToStackAllocate(Alloc, EVI, DT, RemoveTailCallInsts, false,
+                                   IsRowTable ? &RowLoads : nullptr)) {
           return false;
         }
+        for (LoadInst *RowPtr : RowLoads) {
+          if (mayBeUsedAfterRealloc(RowPtr, Alloc, DT) ||
+              !isSafeToStackAllocate(Alloc, RowPtr, DT, RemoveTailCallInsts)) {
+            return false;
+          }
+        }
       }
       break;
     }
@@ -669,6 +787,78 @@ bool isSafeToStackAllocateArray(
   return true;
 }
 
+/// Returns whether the given argument of a call to a function defined in this
+/// module is known not to be captured by the callee.
+static bool isNotCapturedByCallee(CallBase *CB, unsigned ArgNo) {
+  Function *Callee = CB->getCalledFunction();
+  if (!Callee || !Callee->hasExactDefinition() || ArgNo >= Callee->arg_size()) {
+    return false;
+  }
+  return !PointerMayBeCaptured(Callee->getArg(ArgNo), /*ReturnCaptures=*/true,
+                               /*StoreCaptures=*/true);
+}
+
+/// Returns whether the given call is to a runtime function reporting a failed
+/// bounds check.
+static bool isBoundsCheckFailure(CallBase *CB) {
+  Function *Callee = CB->getCalledFunction();
+  if (!Callee) {
+    return false;
+  }
+  return StringSwitch<bool>(Callee->getName())
+      .Cases("_d_arraybounds", "_d_arraybounds_slice", "_d_arraybounds_index",
+             true)
+      .Default(false);
+}
+
+/// Returns whether the given integer, loaded from a table of row slices, is
+/// known not to be a row pointer (loaded as integer by the optimizer) escaping
+/// from the function.
+static bool isNonEscapingInteger(Instruction *Int,
+                                 SmallPtrSetImpl<Instruction *> &Visited) {
+  for (User *U : Int->users()) {
+    auto I = cast<Instruction>(U);
+    if (!Visited.insert(I).second) {
+      continue;
+    }
+
+    switch (I->getOpcode()) {
+    case Instruction::ICmp:
+    case Instruction::Switch:
+    case Instruction::GetElementPtr:
+      // Comparisons and indices don't let the value escape.
+      break;
+    case Instruction::Call:
+    case Instruction::Invoke:
+      // Only the lengths passed to bounds check failure handlers; any other
+      // argument may be a row pointer coerced to an integer by the ABI.
+      if (!isBoundsCheckFailure(cast<CallBase>(I))) {
+        return false;
+      }
+      break;
+    case Instruction::PHI:
+    case Instruction::Select:
+    case Instruction::Trunc:
+    case Instruction::ZExt:
+    case Instruction::SExt:
+    case Instruction::Add:
+    case Instruction::Sub:
+    case Instruction::Mul:
+    case Instruction::Shl:
+    case Instruction::LShr:
+    case Instruction::UDiv:
+      if (!isNonEscapingInteger(I, Visited)) {
+        return false;
+      }
+      break;
+    default:
+      // Stores, inttoptr casts, returns etc.
+      return false;
+    }
+  }
+  return true;
+}
+
 /// Returns true if the GC call passed in is safe to turn
 /// into a stack allocation. This requires that the return value does not
 /// escape from the function and no derived pointers are live at the call site
@@ -690,9 +880,18 @@ bool isSafeToStackAllocateArray(
 /// the attribute has to be removed before promoting the memory to the
 /// stack. The affected instructions are added to RemoveTailCallInsts. If
 /// the function returns false, these entries are meaningless.
+///
+/// If AnalyzeCallees is set, arguments passed to functions defined in this
+/// module are analyzed in the callee if not marked 'nocapture'.
+///
+/// If RowLoads is set, V points to a table of row slices (see RectArrayFI).
+/// The pointers loaded from it are added to RowLoads for the caller to check,
+/// and it must not be passed to calls which might copy the row pointers.
 bool isSafeToStackAllocate(BasicBlock::iterator Alloc, Value *V,
                            DominatorTree &DT,
-                           SmallVector<CallInst *, 4> &RemoveTailCallInsts) {
+                           SmallVector<CallInst *, 4> &RemoveTailCallInsts,
+                           bool AnalyzeCallees,
+                           SmallVectorImpl<LoadInst *> *RowLoads) {
   assert(isa<PointerType>(V->getType()) && "Allocated value is not a pointer?");
 
   SmallVector<Use *, 16> Worklist;
@@ -722,6 +921,11 @@ bool isSafeToStackAllocate(BasicBlock::iterator Alloc, Value *V,
         break;
       }
 
+      // Calls like memcpy() don't capture the table, but may copy the rows.
+      if (RowLoads && CB->getCalledOperand() != V) {
+        return false;
+      }
+
       // Not captured if only passed via 'nocapture' arguments.  Note that
       // calling a function pointer does not in itself cause the pointer to
       // be captured.  This is a subtle point considering that (for example)
@@ -732,7 +936,8 @@ bool isSafeToStackAllocate(BasicBlock::iterator Alloc, Value *V,
       auto B = CB->arg_begin(), E = CB->arg_end();
       for (auto A = B; A != E; ++A) {
         if (A->get() == V) {
-          if (!CB->paramHasAttr(A - B, llvm::Attribute::AttrKind::NoCapture)) {
+          if (!CB->paramHasAttr(A - B, llvm::Attribute::AttrKind::NoCapture) &&
+              !(AnalyzeCallees && isNotCapturedByCallee(CB, A - B))) {
             // The parameter is not marked 'nocapture' - captured.
             return false;
           }
@@ -750,6 +955,18 @@ bool isSafeToStackAllocate(BasicBlock::iterator Alloc, Value *V,
     }
     case Instruction::Load:
       // Loading from a pointer does not cause it to be captured.
+      if (RowLoads) {
+        // But the row pointers loaded from a table of rows must not escape.
+        if (I->getType()->isPointerTy()) {
+          RowLoads->push_back(cast<LoadInst>(I));
+        } else {
+          SmallPtrSet<Instruction *, 16> VisitedInts;
+          if (!I->getType()->isIntegerTy() ||
+              !isNonEscapingInteger(I, VisitedInts)) {
+            return false;
+          }
+        }
+      }
       break;
     case Instruction::Store:
       if (V == I->getOperand(0)) {
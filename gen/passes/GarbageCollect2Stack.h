@@ -61,6 +61,25 @@ public:
   llvm::Value *promote(llvm::CallBase *CB, IRBuilder<> &B, const G2StackAnalysis &A) override;
 
 };
+/// FunctionInfo for _d_newarraymRectT, allocating a rectangular 2-dimensional
+/// array as a table of row slices into a single (zero-initialized) block of
+/// elements.
+class RectArrayFI : public FunctionInfo {
+  unsigned TypeInfoArgNr;
+  unsigned RowsArgNr;
+  unsigned ColsArgNr;
+  uint64_t NumRows;
+  uint64_t NumCols;
+
+public:
+  RectArrayFI(unsigned tiArgNr, unsigned rowsArgNr, unsigned colsArgNr)
+      : FunctionInfo(ReturnType::Array), TypeInfoArgNr(tiArgNr),
+        RowsArgNr(rowsArgNr), ColsArgNr(colsArgNr) {}
+
+  bool analyze(llvm::CallBase *CB, const G2StackAnalysis &A) override;
+
+  llvm::Value *promote(llvm::CallBase *CB, IRBuilder<> &B, const G2StackAnalysis &A) override;
+};
 // FunctionInfo for _d_allocclass
 class AllocClassFI : public FunctionInfo {
 public:
@@ -74,6 +93,8 @@ public:
 /// given size.
 class UntypedMemoryFI : public FunctionInfo {
   unsigned SizeArgNr;
+
+protected:
   llvm::Value *SizeArg;
 
 public:
@@ -84,6 +105,18 @@ public:
   explicit UntypedMemoryFI(unsigned sizeArgNr)
       : FunctionInfo(ReturnType::Pointer), SizeArgNr(sizeArgNr) {}
 };
+/// Describes a closure frame allocation via _d_allocmemory, tagged as such by
+/// the frontend (see CLOSURE_MD).
+class ClosureFI : public UntypedMemoryFI {
+  unsigned Alignment = 0;
+
+public:
+  bool analyze(llvm::CallBase *CB, const G2StackAnalysis &A) override;
+
+  llvm::Value *promote(llvm::CallBase *CB, IRBuilder<> &B, const G2StackAnalysis &A) override;
+
+  explicit ClosureFI(unsigned sizeArgNr) : UntypedMemoryFI(sizeArgNr) {}
+};
 //}
 
 //===----------------------------------------------------------------------===//
@@ -99,8 +132,10 @@ struct GarbageCollect2Stack {
   TypeInfoFI AllocMemoryT;
   ArrayFI NewArrayU;
   ArrayFI NewArrayT;
+  RectArrayFI NewRectArrayT;
   AllocClassFI AllocClass;
   UntypedMemoryFI AllocMemory;
+  ClosureFI AllocClosure;
 
   GarbageCollect2Stack();
 
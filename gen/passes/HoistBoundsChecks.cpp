@@ -0,0 +1,399 @@
+//===-- HoistBoundsChecks.cpp - Hoist array bounds checks out of loops ----===//
+//
+//                         LDC – the LLVM D compiler
+//
+// This file is distributed under the BSD-style LDC license. See the LICENSE
+// file for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file hoists array index bounds checks (branches to
+// `_d_arraybounds_index`) out of innermost loops.
+//
+// A check `idx < length` qualifies if `idx` is an affine induction variable of
+// the loop with a step of +1 or -1 and `length` is loop-invariant. All such
+// checks of a loop are replaced by a single range check in the preheader,
+// covering every index the loop may access. The loop is versioned on that
+// range check: the fast version has the per-iteration checks removed (and so
+// can be vectorized), the slow version is an unmodified copy of the original
+// loop and raises the exact RangeError if some index turns out to be out of
+// bounds.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gen/passes/HoistBoundsChecks.h"
+#include "gen/passes/Passes.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+#define DEBUG_TYPE "hoist-bounds-checks"
+
+using namespace llvm;
+
+STATISTIC(NumChecksHoisted, "Number of array bounds checks hoisted");
+STATISTIC(NumLoopsVersioned,
+          "Number of loops versioned on a hoisted bounds check");
+
+static cl::opt<unsigned>
+    SizeLimit("hoist-bounds-checks-size-limit", cl::ZeroOrMore, cl::Hidden,
+              cl::init(512),
+              cl::desc("Only version loops with at most n instructions, "
+                       "0 to ignore."));
+
+namespace {
+/// A bounds check `Index < Length` branching to `FailBB` if violated.
+struct BoundsCheck {
+  BranchInst *Branch;
+  BasicBlock *FailBB;
+  const SCEVAddRecExpr *Index;
+  const SCEV *Length;
+};
+
+/// Returns true if `BB` reports an array index out of bounds error.
+bool isIndexErrorBlock(const BasicBlock *BB) {
+  if (!isa<UnreachableInst>(BB->getTerminator())) {
+    return false;
+  }
+  for (const Instruction &I : *BB) {
+    if (auto CB = dyn_cast<CallBase>(&I)) {
+      if (auto Callee = CB->getCalledFunction()) {
+        if (Callee->getName() == "_d_arraybounds_index") {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+/// Returns an upper bound for the number of times the backedge of `L` is taken,
+/// i.e., the maximum iteration count minus one, or null if unknown.
+const SCEV *getMaxBackedgeTakenCount(Loop *L, DominatorTree &DT,
+                                     ScalarEvolution &SE) {
+  BasicBlock *Latch = L->getLoopLatch();
+  SmallVector<BasicBlock *, 4> ExitingBlocks;
+  L->getExitingBlocks(ExitingBlocks);
+
+  const SCEV *Result = nullptr;
+  for (BasicBlock *Exiting : ExitingBlocks) {
+    // Only exits evaluated in every iteration bound the iteration count.
+    if (!DT.dominates(Exiting, Latch)) {
+      continue;
+    }
+    const SCEV *Count = SE.getExitCount(L, Exiting);
+    if (isa<SCEVCouldNotCompute>(Count)) {
+      continue;
+    }
+    Result = Result ? SE.getUMinFromMismatchedTypes(Result, Count) : Count;
+  }
+  return Result;
+}
+
+/// Analyzes the conditional branch terminating `BB` and returns true if it is a
+/// hoistable bounds check.
+bool analyzeCheck(BasicBlock *BB, Loop *L, ScalarEvolution &SE,
+                  BoundsCheck &Check) {
+  auto Br = dyn_cast<BranchInst>(BB->getTerminator());
+  if (!Br || !Br->isConditional()) {
+    return false;
+  }
+  auto Cmp = dyn_cast<ICmpInst>(Br->getCondition());
+  if (!Cmp) {
+    return false;
+  }
+
+  // Normalize to `Index ult Length` guarding the non-failing successor.
+  ICmpInst::Predicate Pred = Cmp->getPredicate();
+  BasicBlock *FailBB;
+  if (isIndexErrorBlock(Br->getSuccessor(1))) {
+    FailBB = Br->getSuccessor(1);
+  } else if (isIndexErrorBlock(Br->getSuccessor(0))) {
+    FailBB = Br->getSuccessor(0);
+    Pred = ICmpInst::getInversePredicate(Pred);
+  } else {
+    return false;
+  }
+  Value *Idx = Cmp->getOperand(0);
+  Value *Len = Cmp->getOperand(1);
+  if (Pred == ICmpInst::ICMP_UGT) {
+    std::swap(Idx, Len);
+    Pred = ICmpInst::ICMP_ULT;
+  }
+  if (Pred != ICmpInst::ICMP_ULT || L->contains(FailBB)) {
+    return false;
+  }
+
+  auto Index = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(Idx));
+  if (!Index || Index->getLoop() != L || !Index->isAffine()) {
+    return false;
+  }
+  auto Step = dyn_cast<SCEVConstant>(Index->getStepRecurrence(SE));
+  if (!Step || !(Step->getValue()->isOne() || Step->getValue()->isMinusOne())) {
+    return false;
+  }
+  const SCEV *Length = SE.getSCEV(Len);
+  if (!SE.isLoopInvariant(Length, L)) {
+    return false;
+  }
+
+  Check = {Br, FailBB, Index, Length};
+  return true;
+}
+
+bool canExpand(const SCEV *S, ScalarEvolution &SE, SCEVExpander &Expander) {
+#if LDC_LLVM_VER >= 1600
+  return Expander.isSafeToExpand(S);
+#else
+  return llvm::isSafeToExpand(S, SE);
+#endif
+}
+
+/// Returns whether the condition of `emitRangeCheck` can be expanded.
+bool canEmitRangeCheck(ArrayRef<BoundsCheck> Checks, const SCEV *MaxBTC,
+                       ScalarEvolution &SE, SCEVExpander &Expander) {
+  if (!canExpand(MaxBTC, SE, Expander)) {
+    return false;
+  }
+  for (const BoundsCheck &C : Checks) {
+    if (!canExpand(C.Index->getStart(), SE, Expander) ||
+        !canExpand(C.Length, SE, Expander)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Emits the condition under which none of the `Checks` can fail in any of
+/// the `MaxBTC + 1` iterations of the loop.
+Value *emitRangeCheck(ArrayRef<BoundsCheck> Checks, const SCEV *MaxBTC,
+                      ScalarEvolution &SE, SCEVExpander &Expander,
+                      Instruction *InsertPt) {
+  IRBuilder<> B(InsertPt);
+  Value *Result = nullptr;
+  for (const BoundsCheck &C : Checks) {
+    Type *Ty = C.Index->getType();
+    Value *Start = Expander.expandCodeFor(C.Index->getStart(), Ty, InsertPt);
+    Value *Length = Expander.expandCodeFor(C.Length, Ty, InsertPt);
+    Value *Count = Expander.expandCodeFor(MaxBTC, Ty, InsertPt);
+
+    // The first index needs to be in bounds...
+    Value *Cond = B.CreateICmpULT(Start, Length, "bc.start.ok");
+    // ...and so does the last one, without wrapping around in between.
+    Value *LastOk;
+    auto Step = cast<SCEVConstant>(C.Index->getStepRecurrence(SE));
+    if (Step->getValue()->isOne()) {
+      // Start + Count < Length <=> Count < Length - Start (as Start < Length)
+      LastOk = B.CreateICmpULT(Count, B.CreateSub(Length, Start), "bc.end.ok");
+    } else {
+      // Start - Count >= 0  <=>  Count <= Start
+      LastOk = B.CreateICmpULE(Count, Start, "bc.end.ok");
+    }
+    Cond = B.CreateAnd(Cond, LastOk);
+    Result = Result ? B.CreateAnd(Result, Cond) : Cond;
+  }
+  if (!isa<Constant>(Result)) {
+    Result->setName("bc.inbounds");
+  }
+  return Result;
+}
+
+/// Versions `L` on `InBounds` and removes the `Checks` from the fast version.
+void versionLoop(Loop *L, ArrayRef<BoundsCheck> Checks, LoopInfo &LI,
+                 DominatorTree &DT, Value *InBounds) {
+  BasicBlock *CheckBB = L->getLoopPreheader();
+  BasicBlock *Header = L->getHeader();
+  BasicBlock *FastPH = SplitBlock(CheckBB, CheckBB->getTerminator(), &DT, &LI,
+                                  nullptr, Header->getName() + ".ph");
+
+  // Clone the loop (incl. the new preheader) as slow path.
+  ValueToValueMapTy VMap;
+  SmallVector<BasicBlock *, 8> SlowBlocks;
+  Loop *SlowL = cloneLoopWithPreheader(FastPH, CheckBB, L, VMap, ".bc.slow",
+                                       &LI, &DT, SlowBlocks);
+  remapInstructionsInBlocks(SlowBlocks, VMap);
+
+  Instruction *OrigTerm = CheckBB->getTerminator();
+  auto Br = BranchInst::Create(FastPH, SlowL->getLoopPreheader(), InBounds,
+                               OrigTerm);
+  Br->setMetadata(LLVMContext::MD_prof,
+                  MDBuilder(Br->getContext()).createBranchWeights(2000, 1));
+  OrigTerm->eraseFromParent();
+
+  // The loop is in LCSSA form, so the only uses of loop values outside of it
+  // are PHIs in the exit blocks. Add the incoming values from the slow path.
+  SmallVector<BasicBlock *, 4> ExitBlocks;
+  L->getUniqueExitBlocks(ExitBlocks);
+  for (BasicBlock *Exit : ExitBlocks) {
+    for (PHINode &PN : Exit->phis()) {
+      const unsigned NumIncoming = PN.getNumIncomingValues();
+      for (unsigned i = 0; i < NumIncoming; ++i) {
+        BasicBlock *Pred = PN.getIncomingBlock(i);
+        if (!L->contains(Pred)) {
+          continue;
+        }
+        Value *V = PN.getIncomingValue(i);
+        auto It = VMap.find(V);
+        PN.addIncoming(It != VMap.end() ? static_cast<Value *>(It->second) : V,
+                       cast<BasicBlock>(VMap[Pred]));
+      }
+    }
+  }
+
+  // The slow path is cold; don't blow up code size for it.
+  addStringMetadataToLoop(SlowL, "llvm.loop.unroll.disable");
+  addStringMetadataToLoop(SlowL, "llvm.loop.vectorize.enable", 0);
+
+  // Finally remove the checks from the fast path.
+  for (const BoundsCheck &C : Checks) {
+    BranchInst *CheckBr = C.Branch;
+    BasicBlock *BB = CheckBr->getParent();
+    BasicBlock *OkBB =
+        CheckBr->getSuccessor(CheckBr->getSuccessor(0) == C.FailBB);
+    C.FailBB->removePredecessor(BB);
+    BranchInst::Create(OkBB, CheckBr);
+    CheckBr->eraseFromParent();
+  }
+
+  DT.recalculate(*Header->getParent());
+}
+} // anonymous namespace
+
+bool HoistBoundsChecks::run(Function &F, LoopInfo &LI, DominatorTree &DT,
+                            ScalarEvolution &SE,
+                            OptimizationRemarkEmitter &ORE) {
+  SmallVector<Loop *, 8> Worklist;
+  for (Loop *L : LI.getLoopsInPreorder()) {
+    if (L->getSubLoops().empty()) {
+      Worklist.push_back(L);
+    }
+  }
+
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  bool Changed = false;
+  for (Loop *L : Worklist) {
+    if (!L->isLoopSimplifyForm() || !L->isSafeToClone()) {
+      continue;
+    }
+
+    if (SizeLimit) {
+      unsigned Size = 0;
+      for (BasicBlock *BB : L->blocks()) {
+        Size += BB->size();
+      }
+      if (Size > SizeLimit) {
+        continue;
+      }
+    }
+
+    SmallVector<BoundsCheck, 4> Checks;
+    for (BasicBlock *BB : L->blocks()) {
+      BoundsCheck Check;
+      if (analyzeCheck(BB, L, SE, Check)) {
+        Checks.push_back(Check);
+      }
+    }
+    if (Checks.empty()) {
+      continue;
+    }
+
+    const SCEV *MaxBTC = getMaxBackedgeTakenCount(L, DT, SE);
+    if (!MaxBTC) {
+      continue;
+    }
+    // Bring the iteration count to the type of the indices; bail out if that
+    // would truncate it.
+    Type *IndexTy = Checks[0].Index->getType();
+    if (llvm::any_of(Checks, [&](const BoundsCheck &C) {
+          return C.Index->getType() != IndexTy;
+        }) ||
+        SE.getTypeSizeInBits(MaxBTC->getType()) >
+            SE.getTypeSizeInBits(IndexTy)) {
+      continue;
+    }
+    MaxBTC = SE.getNoopOrZeroExtend(MaxBTC, IndexTy);
+
+    // Make sure everything can be expanded before changing the IR.
+    SCEVExpander Expander(SE, DL, "bc.hoist");
+    if (!canEmitRangeCheck(Checks, MaxBTC, SE, Expander)) {
+      continue;
+    }
+
+    LLVM_DEBUG(dbgs() << "HoistBoundsChecks: hoisting " << Checks.size()
+                      << " check(s) out of " << *L);
+
+    formLCSSARecursively(*L, DT, &LI, &SE);
+
+    Instruction *InsertPt = L->getLoopPreheader()->getTerminator();
+    Value *InBounds = emitRangeCheck(Checks, MaxBTC, SE, Expander, InsertPt);
+
+    ORE.emit([&]() {
+      return OptimizationRemark(DEBUG_TYPE, "Hoisted", L->getStartLoc(),
+                                L->getHeader())
+             << "hoisted " << ore::NV("NumChecks", Checks.size())
+             << " array bounds check(s) out of loop";
+    });
+
+    SE.forgetLoop(L);
+    versionLoop(L, Checks, LI, DT, InBounds);
+
+    NumChecksHoisted += Checks.size();
+    ++NumLoopsVersioned;
+    Changed = true;
+  }
+
+  return Changed;
+}
+
+//===----------------------------------------------------------------------===//
+// Legacy pass manager interface
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct LLVM_LIBRARY_VISIBILITY HoistBoundsChecksLegacyPass
+    : public FunctionPass {
+  static char ID; // Pass identification
+  HoistBoundsChecksLegacyPass() : FunctionPass(ID) {}
+
+  bool runOnFunction(Function &F) override {
+    auto &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    auto &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    auto &SE = getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+    auto &ORE = getAnalysis<OptimizationRemarkEmitterWrapperPass>().getORE();
+    return pass.run(F, LI, DT, SE, ORE);
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    AU.addRequired<OptimizationRemarkEmitterWrapperPass>();
+  }
+
+private:
+  HoistBoundsChecks pass;
+};
+} // anonymous namespace
+
+char HoistBoundsChecksLegacyPass::ID = 0;
+static RegisterPass<HoistBoundsChecksLegacyPass>
+    X("hoist-bounds-checks", "Hoist array bounds checks out of loops");
+
+// Public interface to the pass.
+FunctionPass *createHoistBoundsChecksPass() {
+  return new HoistBoundsChecksLegacyPass();
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "gen/llvm.h"
+#include "gen/passes/Passes.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/PassManager.h"
+
+/// This pass replaces the per-iteration array bounds checks of
+/// induction-variable-indexed accesses in innermost loops by a single range
+/// check in front of the loop. If the range check fails, an unmodified copy of
+/// the loop is executed, so that the original RangeError is still raised for
+/// the exact offending index.
+struct LLVM_LIBRARY_VISIBILITY HoistBoundsChecks {
+  bool run(llvm::Function &F, llvm::LoopInfo &LI, llvm::DominatorTree &DT,
+           llvm::ScalarEvolution &SE, llvm::OptimizationRemarkEmitter &ORE);
+
+  static llvm::StringRef getPassName() { return "HoistBoundsChecks"; }
+};
+
+struct LLVM_LIBRARY_VISIBILITY HoistBoundsChecksPass
+    : public llvm::PassInfoMixin<HoistBoundsChecksPass> {
+
+  llvm::PreservedAnalyses run(llvm::Function &F,
+                              llvm::FunctionAnalysisManager &fam) {
+    auto &LI = fam.getResult<llvm::LoopAnalysis>(F);
+    auto &DT = fam.getResult<llvm::DominatorTreeAnalysis>(F);
+    auto &SE = fam.getResult<llvm::ScalarEvolutionAnalysis>(F);
+    auto &ORE = fam.getResult<llvm::OptimizationRemarkEmitterAnalysis>(F);
+
+    if (pass.run(F, LI, DT, SE, ORE)) {
+      return llvm::PreservedAnalyses::none();
+    }
+    return llvm::PreservedAnalyses::all();
+  }
+
+  static llvm::StringRef name() { return HoistBoundsChecks::getPassName(); }
+
+  HoistBoundsChecksPass() : pass() {}
+
+private:
+  HoistBoundsChecks pass;
+};
@@ -23,6 +23,8 @@ llvm::FunctionPass *createSimplifyDRuntimeCalls();
 
 llvm::FunctionPass *createGarbageCollect2Stack();
 
+llvm::FunctionPass *createHoistBoundsChecksPass();
+
 llvm::ModulePass *createStripExternalsPass();
 
 llvm::ModulePass *createDLLImportRelocationPass();
@@ -20,9 +20,11 @@
 #include "gen/passes/SimplifyDRuntimeCalls.h"
 #include "gen/tollvm.h"
 #include "gen/runtime.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/IRBuilder.h"
@@ -229,6 +231,85 @@ Value *ArraySliceCopyOpt::CallOptimizer(Function *Callee, CallInst *CI,
 }
 
 
+//===---------------------------------------===//
+// '_d_arrayappendcTXCached' Optimizations
+
+/// Returns the call to the cached append hook using the given cache in BB, if
+/// any.
+static CallInst *findAppendWithCache(BasicBlock *BB, Function *Callee,
+                                     Value *Cache) {
+  for (auto &I : *BB) {
+    if (auto CI = dyn_cast<CallInst>(&I)) {
+      if (CI->getCalledFunction() == Callee &&
+          CI->getArgOperand(4)->stripPointerCasts() == Cache) {
+        return CI;
+      }
+    }
+  }
+  return nullptr;
+}
+
+Value *ArrayAppendReserveOpt::CallOptimizer(Function *Callee, CallInst *CI,
+                                            IRBuilder<> &B) {
+  // Verify we have a reasonable prototype for _d_arrayappendcTXCached
+  const FunctionType *FT = Callee->getFunctionType();
+  if (Callee->arg_size() != 5 || !isa<IntegerType>(FT->getParamType(2)) ||
+      FT->getParamType(3) != FT->getParamType(2) ||
+      !isa<PointerType>(FT->getParamType(4))) {
+    return nullptr;
+  }
+
+  // The codegen emits the slow path of an inline append as a separate block,
+  // which is a direct successor of the fast path check. Follow the control
+  // flow from this call to the slow paths of subsequent appends with the same
+  // cache (i.e., to the same array), summing up the number of their elements.
+  // Reserving the capacity for them upfront lets them take the fast path.
+  // The reservation is a mere hint, so this is always safe.
+  Value *Cache = CI->getArgOperand(4)->stripPointerCasts();
+  uint64_t Reserve = 0;
+  SmallPtrSet<BasicBlock *, 16> Visited;
+  Visited.insert(CI->getParent());
+  Instruction *Term = CI->getParent()->getTerminator();
+  for (unsigned Steps = 0; Steps < 64; ++Steps) {
+    BasicBlock *Next = Term->getNumSuccessors() == 1 ? Term->getSuccessor(0)
+                                                     : nullptr;
+    CallInst *NextAppend = nullptr;
+    if (!Next) {
+      // Look for the slow path of the next append.
+      for (BasicBlock *Succ : successors(Term->getParent())) {
+        if ((NextAppend = findAppendWithCache(Succ, Callee, Cache))) {
+          Next = Succ;
+          break;
+        }
+      }
+    } else {
+      NextAppend = findAppendWithCache(Next, Callee, Cache);
+    }
+
+    if (!Next || !Visited.insert(Next).second) {
+      break;
+    }
+
+    if (NextAppend) {
+      auto N = dyn_cast<ConstantInt>(NextAppend->getArgOperand(2));
+      if (!N) {
+        break;
+      }
+      Reserve += N->getZExtValue();
+    }
+    Term = Next->getTerminator();
+  }
+
+  auto OldReserve = dyn_cast<ConstantInt>(CI->getArgOperand(3));
+  if (Reserve == 0 || !OldReserve || OldReserve->getZExtValue() >= Reserve) {
+    return nullptr;
+  }
+
+  CI->setArgOperand(3, ConstantInt::get(FT->getParamType(2), Reserve));
+  *Changed = true;
+  return nullptr;
+}
+
 // TODO: More optimizations! :)
 
 
@@ -274,6 +355,7 @@ void SimplifyDRuntimeCalls::InitOptimizations() {
   Optimizations["_d_arraysetlengthT"] = &ArraySetLength;
   Optimizations["_d_arraysetlengthiT"] = &ArraySetLength;
   Optimizations["_d_array_slice_copy"] = &ArraySliceCopy;
+  Optimizations["_d_arrayappendcTXCached"] = &ArrayAppendReserve;
 
   /* Delete calls to runtime functions which aren't needed if their result is
    * unused. That comes down to functions that don't do anything but
@@ -288,6 +370,8 @@ void SimplifyDRuntimeCalls::InitOptimizations() {
   Optimizations["_d_newarrayT"] = &Allocation;
   Optimizations["_d_newarrayiT"] = &Allocation;
   Optimizations["_d_newarrayU"] = &Allocation;
+  Optimizations["_d_newarraymRectT"] = &Allocation;
+  Optimizations["_d_newarraymRectiT"] = &Allocation;
   Optimizations["_d_newarraymT"] = &Allocation;
   Optimizations["_d_newarraymiT"] = &Allocation;
   Optimizations["_d_newarraymvT"] = &Allocation;
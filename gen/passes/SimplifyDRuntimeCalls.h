@@ -52,6 +52,13 @@ struct LLVM_LIBRARY_VISIBILITY AllocationOpt : public LibCallOptimization {
   llvm::Value *CallOptimizer(llvm::Function *Callee, llvm::CallInst *CI,
                        llvm::IRBuilder<> &B) override;
 };
+/// ArrayAppendReserveOpt - Let the first of a sequence of appends to the same
+/// array reserve the capacity for the following ones
+struct LLVM_LIBRARY_VISIBILITY ArrayAppendReserveOpt
+    : public LibCallOptimization {
+  llvm::Value *CallOptimizer(llvm::Function *Callee, llvm::CallInst *CI,
+                             llvm::IRBuilder<> &B) override;
+};
 /// ArraySliceCopyOpt - Turn slice copies into llvm.memcpy when safe
 struct LLVM_LIBRARY_VISIBILITY ArraySliceCopyOpt : public LibCallOptimization {
   llvm::Value *CallOptimizer(llvm::Function *Callee, llvm::CallInst *CI,
@@ -67,6 +74,7 @@ struct LLVM_LIBRARY_VISIBILITY SimplifyDRuntimeCalls {
   // Array operations
   ArraySetLengthOpt ArraySetLength;
   ArraySliceCopyOpt ArraySliceCopy;
+  ArrayAppendReserveOpt ArrayAppendReserve;
 
   // GC allocations
   AllocationOpt Allocation;
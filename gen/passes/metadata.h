@@ -34,6 +34,20 @@ enum ClassDataFields {
   CD_NumFields /// The number of fields in ClassInfo metadata
 };
 
+// *** Metadata for closure frame allocations ***
+// The GC allocation of the closure frame of a function is tagged with a
+// metadata node of kind CLOSURE_MD, marking it as a candidate for stack
+// promotion if none of the delegates referencing it escape after inlining.
+#define CLOSURE_MD "ldc.closure"
+
+/// The fields in the metadata node for a closure frame allocation.
+enum ClosureDataFields {
+  CL_Alignment, /// The (i32) alignment of the frame.
+
+  // Must be kept last
+  CL_NumFields /// The number of fields in closure metadata
+};
+
 inline std::string getMetadataName(const char *prefix,
                                    llvm::GlobalVariable *forGlobal) {
   llvm::StringRef globalName = forGlobal->getName();
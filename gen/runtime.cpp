@@ -63,7 +63,9 @@ static void checkForImplicitGCCall(const Loc &loc, const char *name) {
   if (nogc) {
     static const std::string GCNAMES[] = {
         "_aaDelX",
+        "_aaDelXD",
         "_aaGetY",
+        "_aaGetYD",
         "_aaKeys",
         "_aaNew",
         "_aaRehash",
@@ -73,6 +75,7 @@ static void checkForImplicitGCCall(const Loc &loc, const char *name) {
         "_d_array_slice_copy",
         "_d_arrayappendT",
         "_d_arrayappendcTX",
+        "_d_arrayappendcTXCached",
         "_d_arrayappendcd",
         "_d_arrayappendwd",
         "_d_arraysetlengthT",
@@ -87,6 +90,8 @@ static void checkForImplicitGCCall(const Loc &loc, const char *name) {
         "_d_newarrayT",
         "_d_newarrayiT",
         "_d_newarrayU",
+        "_d_newarraymRectT",
+        "_d_newarraymRectiT",
         "_d_newclass",
         "_d_allocclass",
         // TODO: _d_newitemT and _d_newarraymTX instantiations
@@ -601,6 +606,19 @@ static void buildRuntimeModule() {
                 {"_d_newarrayT", "_d_newarrayiT", "_d_newarrayU"},
                 {typeInfoTy, sizeTy}, {STCconst, 0});
 
+  // void[] _d_arrayappendcTXCached(const TypeInfo ti, ref byte[] px,
+  //                                 size_t n, size_t reserve,
+  //                                 ArrayAppendCache* cache)
+  createFwdDecl(LINK::c, voidArrayTy, {"_d_arrayappendcTXCached"},
+                {typeInfoTy, voidArrayTy, sizeTy, sizeTy, voidPtrTy},
+                {STCconst, STCref, 0, 0, 0});
+
+  // void[] _d_newarraymRectT (const TypeInfo ti, size_t rows, size_t cols)
+  // void[] _d_newarraymRectiT(const TypeInfo ti, size_t rows, size_t cols)
+  createFwdDecl(LINK::c, voidArrayTy,
+                {"_d_newarraymRectT", "_d_newarraymRectiT"},
+                {typeInfoTy, sizeTy, sizeTy}, {STCconst, 0, 0});
+
   // void[] _d_arrayappendcd(ref byte[] x, dchar c)
   // void[] _d_arrayappendwd(ref byte[] x, dchar c)
   createFwdDecl(LINK::c, voidArrayTy, {"_d_arrayappendcd", "_d_arrayappendwd"},
@@ -645,6 +663,11 @@ static void buildRuntimeModule() {
                 {voidPtrTy, sizeTy, voidPtrTy, sizeTy, sizeTy}, {},
                 Attr_1_3_NoCapture);
 
+  // write barrier for memory written to by non-instrumented code
+  // void _d_gcMarkCards(const void* p, size_t len)
+  createFwdDecl(LINK::c, voidTy, {"_d_gcMarkCards"}, {voidPtrTy, sizeTy}, {},
+                Attr_1_NoCapture);
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -731,6 +754,41 @@ static void buildRuntimeModule() {
   createFwdDecl(LINK::c, boolTy, {"_aaDelX"}, {aaTy, typeInfoTy, voidPtrTy},
                 {0, STCin, STCin}, Attr_1_3_NoCapture);
 
+  // void* _aaGetYD(AA* aa, const TypeInfo aati, in size_t valuesize,
+  //                in void* pkey, KeyHashFn keyHash, KeyEqualsFn keyEquals)
+  createFwdDecl(LINK::c, voidPtrTy, {"_aaGetYD"},
+                {pointerTo(aaTy), aaTypeInfoTy, sizeTy, voidPtrTy, voidPtrTy,
+                 voidPtrTy},
+                {0, STCconst, STCin, STCin, 0, 0}, Attr_1_4_NoCapture);
+
+  // inout(void)* _aaInXD(inout AA aa, in TypeInfo keyti, in void* pkey,
+  //                      KeyHashFn keyHash, KeyEqualsFn keyEquals)
+  createFwdDecl(LINK::c, voidPtrTy, {"_aaInXD"},
+                {aaTy, typeInfoTy, voidPtrTy, voidPtrTy, voidPtrTy},
+                {STCin | STCout, STCin, STCin, 0, 0},
+                Attr_ReadOnly_1_3_NoCapture);
+
+  // bool _aaDelXD(AA aa, in TypeInfo keyti, in void* pkey,
+  //               KeyHashFn keyHash, KeyEqualsFn keyEquals)
+  createFwdDecl(LINK::c, boolTy, {"_aaDelXD"},
+                {aaTy, typeInfoTy, voidPtrTy, voidPtrTy, voidPtrTy},
+                {0, STCin, STCin, 0, 0}, Attr_1_3_NoCapture);
+
+  // size_t _aaKeyHash_*(in void* pkey)
+  createFwdDecl(LINK::c, sizeTy,
+                {"_aaKeyHash_h", "_aaKeyHash_t", "_aaKeyHash_k", "_aaKeyHash_m",
+                 "_aaKeyHash_Ah", "_aaKeyHash_At", "_aaKeyHash_Ak",
+                 "_aaKeyHash_Am"},
+                {voidPtrTy}, {STCin}, Attr_ReadOnly_NoUnwind_1_NoCapture);
+
+  // bool _aaKeyEquals_*(in void* k1, in void* k2)
+  createFwdDecl(LINK::c, boolTy,
+                {"_aaKeyEquals_h", "_aaKeyEquals_t", "_aaKeyEquals_k",
+                 "_aaKeyEquals_m", "_aaKeyEquals_Ah", "_aaKeyEquals_At",
+                 "_aaKeyEquals_Ak", "_aaKeyEquals_Am"},
+                {voidPtrTy, voidPtrTy}, {STCin, STCin},
+                Attr_ReadOnly_NoUnwind_1_2_NoCapture);
+
   // int _aaEqual(in TypeInfo tiRaw, in AA e1, in AA e2)
   createFwdDecl(LINK::c, intTy, {"_aaEqual"}, {typeInfoTy, aaTy, aaTy},
                 {STCin, STCin, STCin}, Attr_1_2_NoCapture);
@@ -824,6 +882,12 @@ static void buildRuntimeModule() {
   if (global.params.cov) {
     createFwdDecl(LINK::c, voidTy, {"_d_cover_register2"},
                   {stringTy, arrayOf(sizeTy), arrayOf(uintTy), ubyteTy});
+    // extern (C) void _d_cover_register3(string filename, size_t[] valid,
+    //                                    uint[] data, ubyte minPercent,
+    //                                    void* shardGetter)
+    createFwdDecl(LINK::c, voidTy, {"_d_cover_register3"},
+                  {stringTy, arrayOf(sizeTy), arrayOf(uintTy), ubyteTy,
+                   voidPtrTy});
   }
 
   if (target.objc.supported) {
@@ -875,6 +939,11 @@ static void buildRuntimeModule() {
   // extern(C) void _c_trace_epi()
   createFwdDecl(LINK::c, voidTy, {"_c_trace_epi"}, {});
 
+  // extern(C) void _d_trace_enter(immutable(string)* id)
+  // extern(C) void _d_trace_exit(immutable(string)* id)
+  createFwdDecl(LINK::c, voidTy, {"_d_trace_enter", "_d_trace_exit"},
+                {voidPtrTy}, {}, Attr_NoUnwind);
+
   //////////////////////////////////////////////////////////////////////////////
   //////////////////////////////////////////////////////////////////////////////
   ////// C standard library functions (a druntime link dependency)
@@ -279,6 +279,18 @@ static LLType *getPtrToAtomicType(LLType *type) {
   }
 }
 
+// With -gc-write-barriers, marks the GC card of an atomic write of a `type`
+// value to `ptr`. core.atomic instantiates the intrinsics with integers of the
+// value's size, so integers which can hold a pointer are treated as pointers.
+static void emitAtomicWriteBarrier(LLType *type, LLValue *ptr) {
+  const uint64_t ptrSize = gDataLayout->getPointerSize();
+  if (type->isIntegerTy() && getTypeStoreSize(type) >= ptrSize) {
+    type = llvm::ArrayType::get(getVoidPtrType(),
+                                getTypeStoreSize(type) / ptrSize);
+  }
+  DtoGCWriteBarrier(type, ptr);
+}
+
 static LLType *getAtomicType(LLType *type) {
   switch (const size_t N = getTypeBitSize(type)) {
   case 8:
@@ -434,6 +446,7 @@ bool DtoLowerMagicIntrinsic(IRState *p, FuncDeclaration *fndecl, CallExp *e,
     if (auto alignment = getTypeAllocSize(val->getType())) {
       ret->setAlignment(llvm::Align(alignment));
     }
+    emitAtomicWriteBarrier(pointeeType, ptr);
     return true;
   }
 
@@ -530,6 +543,8 @@ bool DtoLowerMagicIntrinsic(IRState *p, FuncDeclaration *fndecl, CallExp *e,
 #endif
                                  successOrdering, failureOrdering);
     ret->setWeak(isWeak);
+    // conservatively also if the exchange fails
+    emitAtomicWriteBarrier(pointeeType, ptr);
 
     // we return a struct; allocate on stack and store to both fields manually
     // (avoiding DtoAllocaDump() due to bad optimized codegen, most likely
@@ -581,6 +596,9 @@ bool DtoLowerMagicIntrinsic(IRState *p, FuncDeclaration *fndecl, CallExp *e,
                                llvm::MaybeAlign(), // default alignment
 #endif
                                llvm::AtomicOrdering(atomicOrdering));
+    if (op == llvm::AtomicRMWInst::Xchg) {
+      emitAtomicWriteBarrier(val->getType(), ptr);
+    }
     result = new DImValue(exp2->type, ret);
     return true;
   }
@@ -723,6 +723,8 @@ public:
         DValue *result = nullptr;
         if (DtoLowerMagicIntrinsic(p, fd, e, result))
           return result;
+        if (DtoLowerArrayAppendHook(e->loc, fd, e, result))
+          return result;
       }
     }
 
@@ -1575,6 +1577,11 @@ public:
         DValue *sz = toElem((*e->arguments)[0]);
         // allocate & init
         result = DtoNewDynArray(e->loc, e->newtype, sz, true);
+      } else if (e->arguments->length == 2 &&
+                 DtoIsFusableRectDynArray(e->newtype)) {
+        DValue *rows = toElem((*e->arguments)[0]);
+        DValue *cols = toElem((*e->arguments)[1]);
+        result = DtoNewRectDynArray(e->loc, e->newtype, rows, cols);
       } else {
         assert(e->lowering);
         LLValue *pair = DtoRVal(e->lowering);
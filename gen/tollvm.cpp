@@ -38,6 +38,7 @@
 #include "ir/irtypeclass.h"
 #include "ir/irtypefunction.h"
 #include "ir/irtypestruct.h"
+#include "llvm/Analysis/ValueTracking.h"
 
 using namespace dmd;
 
@@ -428,7 +429,94 @@ void DtoMemSetZero(LLType *type, LLValue *dst, unsigned align) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void DtoMemCpy(LLValue *dst, LLValue *src, LLValue *nbytes, unsigned align) {
+namespace {
+// log2 of the number of bytes covered by a card of the GC card table, must
+// match CARD_SHIFT in druntime's core.internal.gc.impl.conservative.gc.
+constexpr unsigned gcCardShift = 9;
+
+bool containsPointers(LLType *t) {
+  if (t->isPointerTy())
+    return true;
+  if (auto st = llvm::dyn_cast<LLStructType>(t)) {
+    for (LLType *e : st->elements()) {
+      if (containsPointers(e))
+        return true;
+    }
+    return false;
+  }
+  if (auto at = llvm::dyn_cast<LLArrayType>(t))
+    return containsPointers(at->getElementType());
+  if (auto vt = llvm::dyn_cast<llvm::VectorType>(t))
+    return containsPointers(vt->getElementType());
+  return false;
+}
+
+// Stores to the stack and to static data don't need barriers, both are
+// scanned completely by every collection.
+bool needsGCWriteBarrier(LLValue *dst) {
+  if (!opts::gcWriteBarriers || !global.params.useGC || gIR->dcomputetarget)
+    return false;
+  const LLValue *obj = llvm::getUnderlyingObject(dst);
+  return !llvm::isa<llvm::AllocaInst>(obj) &&
+         !llvm::isa<llvm::GlobalVariable>(obj);
+}
+
+// Dirties the card of `addr` (a size_t) in druntime's `_d_gcCardTable`:
+//   cards[(addr >> gcCardShift) & mask] = 1
+void emitGCCardMark(LLValue *addr) {
+  const char *name = "_d_gcCardTable";
+  LLGlobalVariable *table = gIR->module.getGlobalVariable(name);
+  if (!table) {
+    auto type =
+        LLStructType::get(gIR->context(), {getVoidPtrType(), DtoSize_t()});
+    table = declareGlobal(Loc(), gIR->module, type, name, false, false,
+                          global.params.dllimport != DLLImport::none);
+  }
+
+  LLType *tableTy = table->getValueType();
+  LLValue *cards = DtoLoad(getVoidPtrType(), ::DtoGEP(tableTy, table, 0u, 0u),
+                           "gc.cards");
+  LLValue *mask =
+      DtoLoad(DtoSize_t(), ::DtoGEP(tableTy, table, 0u, 1u), "gc.cardmask");
+  LLValue *index = gIR->ir->CreateAnd(
+      gIR->ir->CreateLShr(addr, DtoConstSize_t(gcCardShift)), mask);
+  LLValue *card = DtoGEP1(LLType::getInt8Ty(gIR->context()), cards, index,
+                          "gc.card");
+  gIR->ir->CreateStore(DtoConstUbyte(1), card);
+}
+} // anonymous namespace
+
+void DtoGCWriteBarrier(LLType *type, LLValue *dst) {
+  if (!containsPointers(type) || !needsGCWriteBarrier(dst))
+    return;
+
+  const uint64_t size = getTypeStoreSize(type);
+  if (size > (1u << gcCardShift)) {
+    DtoGCMarkCards(dst, DtoConstSize_t(size));
+    return;
+  }
+
+  // the value spans at most 2 cards
+  LLValue *addr = gIR->ir->CreatePtrToInt(dst, DtoSize_t());
+  emitGCCardMark(addr);
+  if (size > 1) {
+    emitGCCardMark(gIR->ir->CreateAdd(addr, DtoConstSize_t(size - 1)));
+  }
+}
+
+void DtoGCMarkCards(LLValue *dst, LLValue *nbytes) {
+  if (!needsGCWriteBarrier(dst))
+    return;
+
+  LLFunction *fn = getRuntimeFunction(Loc(), gIR->module, "_d_gcMarkCards");
+  gIR->CreateCallOrInvoke(fn, {DtoBitCast(dst, getVoidPtrType()), nbytes}, "",
+                          /*isNothrow=*/true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void DtoMemCpyImpl(LLValue *dst, LLValue *src, LLValue *nbytes,
+                          unsigned align) {
   LLType *VoidPtrTy = getVoidPtrType();
 
   dst = DtoBitCast(dst, VoidPtrTy);
@@ -438,10 +526,18 @@ void DtoMemCpy(LLValue *dst, LLValue *src, LLValue *nbytes, unsigned align) {
   gIR->ir->CreateMemCpy(dst, A, src, A, nbytes, false /*isVolatile*/);
 }
 
+void DtoMemCpy(LLValue *dst, LLValue *src, LLValue *nbytes, unsigned align) {
+  DtoMemCpyImpl(dst, src, nbytes, align);
+  // the copied memory might contain pointers
+  DtoGCMarkCards(dst, nbytes);
+}
+
 void DtoMemCpy(LLType *type, LLValue *dst, LLValue *src, bool withPadding, unsigned align) {
   uint64_t n =
       withPadding ? getTypeAllocSize(type) : getTypeStoreSize(type);
-  DtoMemCpy(dst, src, DtoConstSize_t(n), align);
+  DtoMemCpyImpl(dst, src, DtoConstSize_t(n), align);
+  if (containsPointers(type))
+    DtoGCMarkCards(dst, DtoConstSize_t(n));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -558,12 +654,14 @@ void DtoStore(LLValue *src, LLValue *dst) {
   assert(!src->getType()->isIntegerTy(1) &&
          "Should store bools as i8 instead of i1.");
   gIR->ir->CreateStore(src, dst);
+  DtoGCWriteBarrier(src->getType(), dst);
 }
 
 void DtoVolatileStore(LLValue *src, LLValue *dst) {
   assert(!src->getType()->isIntegerTy(1) &&
          "Should store bools as i8 instead of i1.");
   gIR->ir->CreateStore(src, dst)->setVolatile(true);
+  DtoGCWriteBarrier(src->getType(), dst);
 }
 
 void DtoStoreZextI8(LLValue *src, LLValue *dst) {
@@ -572,6 +670,7 @@ void DtoStoreZextI8(LLValue *src, LLValue *dst) {
     src = gIR->ir->CreateZExt(src, i8);
   }
   gIR->ir->CreateStore(src, dst);
+  DtoGCWriteBarrier(src->getType(), dst);
 }
 
 // Like DtoStore, but the pointer is guaranteed to be aligned appropriately for
@@ -581,6 +680,7 @@ void DtoAlignedStore(LLValue *src, LLValue *dst) {
          "Should store bools as i8 instead of i1.");
   llvm::StoreInst *st = gIR->ir->CreateStore(src, dst);
   st->setAlignment(gDataLayout->getABITypeAlign(src->getType()));
+  DtoGCWriteBarrier(src->getType(), dst);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -215,6 +215,25 @@ void DtoMemCpy(LLValue *dst, LLValue *src, LLValue *nbytes, unsigned align = 1);
 void DtoMemCpy(LLType *type, LLValue *dst, LLValue *src, bool withPadding = false,
                unsigned align = 1);
 
+/**
+ * With -gc-write-barriers, marks the GC cards of memory written to by
+ * non-instrumented code (e.g., runtime hooks), unless dst is known to be on the
+ * stack or static data.
+ * @param dst Destination memory.
+ * @param nbytes Number of bytes written.
+ */
+void DtoGCMarkCards(LLValue *dst, LLValue *nbytes);
+
+/**
+ * With -gc-write-barriers, marks the GC card(s) of a store of a `type` value
+ * to `dst` if the type contains pointers, unless dst is known to be on the
+ * stack or static data. DtoStore and friends do so implicitly; this is for
+ * stores emitted directly via the IRBuilder.
+ * @param type Type of the stored value.
+ * @param dst Destination memory.
+ */
+void DtoGCWriteBarrier(LLType *type, LLValue *dst);
+
 /**
  * Generates a call to C memcmp.
  */
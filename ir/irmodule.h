@@ -44,6 +44,11 @@ struct IrModule {
   GatesList sharedGates;
   FuncDeclList unitTests;
   llvm::Function *coverageCtor = nullptr;
+  // TLS uint[# source lines] _d_cover_shard (-cov-increment=sharded)
+  llvm::GlobalVariable *coverageShard = nullptr;
+
+  // pointer-free mutable globals defined in this module (-fprecise-data-scan)
+  std::list<VarDeclaration *> noScanGlobals;
 
   llvm::DIModule *diModule = nullptr;
 
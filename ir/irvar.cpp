@@ -12,6 +12,8 @@
 #include "dmd/declaration.h"
 #include "dmd/errors.h"
 #include "dmd/init.h"
+#include "dmd/mtype.h"
+#include "driver/cl_options.h"
 #include "gen/dynamiccompile.h"
 #include "gen/irstate.h"
 #include "gen/llvm.h"
@@ -21,6 +23,7 @@
 #include "gen/pragma.h"
 #include "gen/uda.h"
 #include "ir/irdsymbol.h"
+#include "ir/irmodule.h"
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -147,6 +150,13 @@ void IrGlobal::define() {
   if (gvar->hasDLLExportStorageClass() && V->isThreadlocal())
     gvar->setDLLStorageClass(LLGlobalValue::DefaultStorageClass);
 
+  // With -fprecise-data-scan, tell the GC about mutable D globals without
+  // pointers, so that it can skip them when scanning the data/TLS segments.
+  if (opts::fPreciseDataScan && !gvar->isConstant() && !V->isCsymbol() &&
+      !dmd::hasPointers(V->type)) {
+    getIrModule(gIR->dmodule)->noScanGlobals.push_back(V);
+  }
+
   // If this global is used from a naked function, we need to create an
   // artificial "use" for it, or it could be removed by the optimizer if
   // the only reference to it is in inline asm.